@@ -8,5 +8,6 @@ void display_system_info(GtkWidget *info_label);
 void display_file_system_info(GtkWidget *info_label);
 void display_resource_usage(GtkWidget *info_label);
 void display_process_info(GtkWidget *info_label);
+int run_benchmarks(int argc, char *argv[]);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,404 @@
+/*
+ * bench.c
+ * Headless benchmarks, run with `./mytaskmanager --bench [name]`.
+ * They read the live /proc of the machine they run on, so compare numbers
+ * taken on the same host.
+ */
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pwd.h>
+
+#include "app.h"
+#include "process_query.h"
+#include "procfs.h"
+#include "sampler.h"
+#include "scan_pool.h"
+
+#define BENCH_ROUNDS 5
+
+static int compare_gint64(const void *a, const void *b) {
+    gint64 x = *(const gint64 *)a, y = *(const gint64 *)b;
+    return (x > y) - (x < y);
+}
+
+// Full /proc walk with 1..N scan threads; reports the median of BENCH_ROUNDS
+static void bench_scan(void) {
+    guint max_threads = g_get_num_processors();
+
+    printf("Process scan scaling (%d rounds, median)\n", BENCH_ROUNDS);
+    printf("%8s %10s %12s %8s\n", "threads", "processes", "time (ms)", "speedup");
+
+    double baseline = 0.0;
+    for (guint n = 1; n <= max_threads; n++) {
+        ScanPool *pool = scan_pool_new(n);
+        gint64 times[BENCH_ROUNDS];
+        guint processes = 0;
+
+        // Warm the dentry cache so the first row is not penalised
+        process_columns_free(sampler_collect_processes(pool));
+
+        for (int round = 0; round < BENCH_ROUNDS; round++) {
+            gint64 start = g_get_monotonic_time();
+            ProcessColumns *result = sampler_collect_processes(pool);
+            times[round] = g_get_monotonic_time() - start;
+            processes = result->len;
+            process_columns_free(result);
+        }
+        scan_pool_free(pool);
+
+        qsort(times, BENCH_ROUNDS, sizeof(times[0]), compare_gint64);
+        double ms = times[BENCH_ROUNDS / 2] / 1000.0;
+        if (n == 1) {
+            baseline = ms;
+        }
+        printf("%8u %10u %12.2f %7.2fx\n", n, processes, ms, ms > 0 ? baseline / ms : 0.0);
+    }
+}
+
+// Uncached owner lookup as done per process before user_cache.c
+static gchar *legacy_username(uid_t uid) {
+    struct passwd pwd;
+    struct passwd *pw = NULL;
+    char buf[1024];
+    if (getpwuid_r(uid, &pwd, buf, sizeof(buf), &pw) == 0 && pw != NULL) {
+        return g_strdup(pw->pw_name);
+    }
+    return g_strdup("Unknown");
+}
+
+// The status + statm path that the sampler used before procfs.c, kept as the
+// reference for bench_parse()
+static gboolean legacy_get_process_details(long pid, gchar** out_name, gchar** out_status, gfloat* out_memory, gchar** out_user) {
+    gchar *status_path = g_strdup_printf("/proc/%ld/status", pid);
+    gchar *status_contents = NULL;
+    GError *error = NULL;
+
+    // Read the status file for name and status
+    if (!g_file_get_contents(status_path, &status_contents, NULL, &error)) {
+        g_error_free(error);
+        g_free(status_path);
+        return FALSE;
+    }
+
+    gchar **lines = g_strsplit(status_contents, "\n", -1);
+    uid_t uid = -1;
+    for (gint i = 0; lines[i] != NULL; i++) {
+        if (g_str_has_prefix(lines[i], "Name:")) {
+            *out_name = g_strdup(g_strstrip(lines[i] + 5));
+        } else if (g_str_has_prefix(lines[i], "State:")) {
+            *out_status = g_strdup(g_strstrip(lines[i] + 6));
+        } else if (g_str_has_prefix(lines[i], "Uid:")) {
+            gchar **tokens = g_strsplit(lines[i], "\t", -1);
+            uid = (uid_t)g_ascii_strtoull(tokens[1], NULL, 10);
+            g_strfreev(tokens);
+        }
+    }
+    g_strfreev(lines);
+    g_free(status_contents);
+    g_free(status_path);
+
+    // Get the username from UID
+    if (uid != -1) {
+        *out_user = legacy_username(uid);
+    } else {
+        *out_user = g_strdup("Unknown");
+    }
+
+    // Memory usage is read from /proc/[pid]/statm
+    gchar *mem_path = g_strdup_printf("/proc/%ld/statm", pid);
+    gchar *mem_contents = NULL;
+
+    if (g_file_get_contents(mem_path, &mem_contents, NULL, NULL)) {
+        long page_size = sysconf(_SC_PAGESIZE); // Get system page size
+        *out_memory = g_ascii_strtoll(mem_contents, NULL, 10) * page_size / 1024.0 / 1024.0; // Convert to MiB
+        g_free(mem_contents);
+    } else {
+        *out_memory = 0.0; // In case of failure to read memory info
+    }
+    g_free(mem_path);
+
+    return TRUE;
+}
+
+static GArray *list_pids(void) {
+    GArray *pids = g_array_new(FALSE, FALSE, sizeof(long));
+    DIR *dir = opendir("/proc");
+    struct dirent *entry;
+
+    if (dir == NULL) {
+        return pids;
+    }
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_type == DT_DIR && isdigit(entry->d_name[0])) {
+            long pid = strtol(entry->d_name, NULL, 10);
+            g_array_append_val(pids, pid);
+        }
+    }
+    closedir(dir);
+    return pids;
+}
+
+// Per-process cost of the legacy status/statm reader against procfs_read_pid_stat()
+static void bench_parse(void) {
+    GArray *pids = list_pids();
+    int proc_fd = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    gint64 legacy_times[BENCH_ROUNDS], procfs_times[BENCH_ROUNDS];
+    guint legacy_ok = 0, procfs_ok = 0;
+
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        gint64 start = g_get_monotonic_time();
+        legacy_ok = 0;
+        for (guint i = 0; i < pids->len; i++) {
+            gchar *name = NULL, *status = NULL, *user = NULL;
+            gfloat memory;
+            if (legacy_get_process_details(g_array_index(pids, long, i), &name, &status, &memory, &user)) {
+                legacy_ok++;
+            }
+            g_free(name);
+            g_free(status);
+            g_free(user);
+        }
+        legacy_times[round] = g_get_monotonic_time() - start;
+
+        start = g_get_monotonic_time();
+        procfs_ok = 0;
+        for (guint i = 0; i < pids->len; i++) {
+            ProcStat stat;
+            if (procfs_read_pid_stat(proc_fd, g_array_index(pids, long, i), &stat)) {
+                procfs_ok++;
+            }
+        }
+        procfs_times[round] = g_get_monotonic_time() - start;
+    }
+
+    qsort(legacy_times, BENCH_ROUNDS, sizeof(gint64), compare_gint64);
+    qsort(procfs_times, BENCH_ROUNDS, sizeof(gint64), compare_gint64);
+    double legacy_us = (double)legacy_times[BENCH_ROUNDS / 2] / MAX(legacy_ok, 1);
+    double procfs_us = (double)procfs_times[BENCH_ROUNDS / 2] / MAX(procfs_ok, 1);
+
+    printf("Per-process parse cost over %u PIDs (%d rounds, median)\n", pids->len, BENCH_ROUNDS);
+    printf("%-28s %10s %12s\n", "reader", "parsed", "us/process");
+    printf("%-28s %10u %12.2f\n", "status+statm, g_strsplit", legacy_ok, legacy_us);
+    printf("%-28s %10u %12.2f\n", "stat+statm, stack buffers", procfs_ok, procfs_us);
+    printf("speedup: %.2fx\n", procfs_us > 0 ? legacy_us / procfs_us : 0.0);
+
+    close(proc_fd);
+    g_array_unref(pids);
+}
+
+#define BENCH_QUERY_ROWS 50000
+
+// Cost of matching compiled queries against every row of a large snapshot,
+// built by repeating the live process table up to BENCH_QUERY_ROWS rows
+static void bench_query(void) {
+    static const char *queries[] = {
+        "sh",
+        "state:D",
+        "user:root cpu>20",
+        "mem>500",
+        "user:postgres state:D mem>500 cpu>20",
+        "cmd~^(kworker|ksoftirqd)/",
+    };
+    ScanPool *pool = scan_pool_new(0);
+    ProcessColumns *live = sampler_collect_processes(pool);
+    scan_pool_free(pool);
+
+    if (live->len == 0) {
+        printf("No processes to search\n");
+        process_columns_free(live);
+        return;
+    }
+
+    ProcessColumns *columns = process_columns_new(BENCH_QUERY_ROWS);
+    for (guint i = 0; i < BENCH_QUERY_ROWS; i++) {
+        process_columns_copy_row(columns, i, live, i % live->len);
+        columns->cpu_usage[i] = (gfloat)(i % 100);
+    }
+    columns->len = BENCH_QUERY_ROWS;
+    process_columns_index_names(columns);
+    process_columns_free(live);
+
+    printf("Query matching over %u rows (%d rounds, median)\n", columns->len, BENCH_ROUNDS);
+    printf("%-40s %10s %12s\n", "query", "matches", "time (ms)");
+
+    for (guint q = 0; q < G_N_ELEMENTS(queries); q++) {
+        GError *error = NULL;
+        ProcessQuery *query = process_query_new(queries[q], &error);
+        gint64 times[BENCH_ROUNDS];
+        guint matches = 0;
+
+        if (query == NULL) {
+            printf("%-40s %s\n", queries[q], error->message);
+            g_error_free(error);
+            continue;
+        }
+
+        for (int round = 0; round < BENCH_ROUNDS; round++) {
+            gint64 start = g_get_monotonic_time();
+            matches = 0;
+            for (guint row = 0; row < columns->len; row++) {
+                matches += process_query_match(query, columns, row);
+            }
+            times[round] = g_get_monotonic_time() - start;
+        }
+        process_query_free(query);
+
+        qsort(times, BENCH_ROUNDS, sizeof(gint64), compare_gint64);
+        printf("%-40s %10u %12.3f\n", queries[q], matches, times[BENCH_ROUNDS / 2] / 1000.0);
+    }
+
+    process_columns_free(columns);
+}
+
+// One tick's CPU, memory and network reads as the sampler did them before
+// procfs_file_read(): fopen, fgets and sscanf on every pass
+static void legacy_read_system(SystemSample *sample) {
+    char buf[1024];
+    unsigned long long int user, nice, system, idle, iowait, irq, softirq, steal, receive, transmit;
+    guint cpu;
+    FILE *fp;
+
+    if ((fp = fopen("/proc/stat", "r")) != NULL) {
+        while (fgets(buf, sizeof(buf), fp) != NULL && strncmp(buf, "cpu", 3) == 0) {
+            if (buf[3] == ' ') {
+                sscanf(buf, "cpu %llu %llu %llu %llu %llu %llu %llu %llu",
+                       &user, &nice, &system, &idle, &iowait, &irq, &softirq, &steal);
+            } else if (sscanf(buf, "cpu%u %llu %llu %llu %llu %llu %llu %llu %llu",
+                              &cpu, &user, &nice, &system, &idle, &iowait, &irq, &softirq, &steal) == 9 &&
+                       cpu < SAMPLER_MAX_CPUS) {
+                sample->cores.user[cpu] = user + nice;
+            }
+        }
+        fclose(fp);
+    }
+
+    if ((fp = fopen("/proc/meminfo", "r")) != NULL) {
+        while (fgets(buf, sizeof(buf), fp)) {
+            sscanf(buf, "MemTotal: %lu kB", &sample->mem_total);
+            sscanf(buf, "MemFree: %lu kB", &sample->mem_free);
+            sscanf(buf, "SwapTotal: %lu kB", &sample->swap_total);
+            sscanf(buf, "SwapFree: %lu kB", &sample->swap_free);
+        }
+        fclose(fp);
+    }
+
+    if ((fp = fopen("/proc/net/dev", "r")) != NULL) {
+        fgets(buf, sizeof(buf), fp);
+        fgets(buf, sizeof(buf), fp);
+        while (fgets(buf, sizeof(buf), fp) != NULL && sample->n_interfaces < SAMPLER_MAX_INTERFACES) {
+            char *colon = strchr(buf, ':');
+            if (colon != NULL &&
+                sscanf(colon + 1, "%llu %*u %*u %*u %*u %*u %*u %*u %llu", &receive, &transmit) == 2) {
+                *colon = '\0';
+                InterfaceSample *out = &sample->interfaces[sample->n_interfaces++];
+                g_strlcpy(out->name, g_strstrip(buf), sizeof(out->name));
+                out->received = receive;
+                out->transmitted = transmit;
+            }
+        }
+        fclose(fp);
+    }
+}
+
+// read() and pread() calls this process has made, from /proc/self/io. The
+// read behind each call is counted too, so a difference of two calls
+// includes one read of its own.
+static guint64 read_calls(int proc_fd) {
+    ProcIo io = { 0 };
+    procfs_read_pid_io(proc_fd, getpid(), &io);
+    return io.syscr;
+}
+
+#define BENCH_SYSTEM_PASSES 1000
+
+// Read calls and time of one tick's system-wide reads, stdio against the
+// files kept open by the sampler. Both are counted by the kernel in the same
+// way. Opens and closes are not: stdio also opens, fstats and closes every
+// file on every pass, which `strace -c -f ./mytaskmanager --bench system`
+// shows alongside the reads.
+static void bench_system(void) {
+    int proc_fd = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    SystemSample *sample = g_new0(SystemSample, 1);
+    gint64 legacy_times[BENCH_ROUNDS], procfs_times[BENCH_ROUNDS];
+    guint64 legacy_reads = 0, procfs_reads = 0;
+
+    // First passes open the files and size the buffers
+    legacy_read_system(sample);
+    sampler_collect_system(sample);
+
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        guint64 reads = read_calls(proc_fd);
+        gint64 start = g_get_monotonic_time();
+        for (int pass = 0; pass < BENCH_SYSTEM_PASSES; pass++) {
+            memset(sample, 0, sizeof(*sample));
+            legacy_read_system(sample);
+        }
+        legacy_times[round] = g_get_monotonic_time() - start;
+        legacy_reads = read_calls(proc_fd) - reads - 1;
+
+        reads = read_calls(proc_fd);
+        start = g_get_monotonic_time();
+        for (int pass = 0; pass < BENCH_SYSTEM_PASSES; pass++) {
+            memset(sample, 0, sizeof(*sample));
+            sampler_collect_system(sample);
+        }
+        procfs_times[round] = g_get_monotonic_time() - start;
+        procfs_reads = read_calls(proc_fd) - reads - 1;
+    }
+
+    qsort(legacy_times, BENCH_ROUNDS, sizeof(gint64), compare_gint64);
+    qsort(procfs_times, BENCH_ROUNDS, sizeof(gint64), compare_gint64);
+    double legacy_us = (double)legacy_times[BENCH_ROUNDS / 2] / BENCH_SYSTEM_PASSES;
+    double procfs_us = (double)procfs_times[BENCH_ROUNDS / 2] / BENCH_SYSTEM_PASSES;
+
+    printf("CPU, memory and network reads per tick (%d passes, %d rounds, median)\n",
+           BENCH_SYSTEM_PASSES, BENCH_ROUNDS);
+    printf("%-28s %12s %12s\n", "reader", "reads/tick", "us/tick");
+    printf("%-28s %12.1f %12.2f\n", "fopen, fgets, sscanf", (double)legacy_reads / BENCH_SYSTEM_PASSES, legacy_us);
+    printf("%-28s %12.1f %12.2f\n", "open files, pread, tokenizer", (double)procfs_reads / BENCH_SYSTEM_PASSES, procfs_us);
+    printf("speedup: %.2fx\n", procfs_us > 0 ? legacy_us / procfs_us : 0.0);
+
+    g_free(sample);
+    close(proc_fd);
+}
+
+typedef struct {
+    const char *name;
+    void (*run)(void);
+} Benchmark;
+
+static const Benchmark benchmarks[] = {
+    { "scan", bench_scan },
+    { "parse", bench_parse },
+    { "query", bench_query },
+    { "system", bench_system },
+};
+
+int run_benchmarks(int argc, char *argv[]) {
+    const char *name = argc > 0 ? argv[0] : "all";
+    gboolean found = FALSE;
+
+    for (guint i = 0; i < G_N_ELEMENTS(benchmarks); i++) {
+        if (strcmp(name, "all") == 0 || strcmp(name, benchmarks[i].name) == 0) {
+            benchmarks[i].run();
+            found = TRUE;
+        }
+    }
+
+    if (!found) {
+        fprintf(stderr, "Unknown benchmark '%s'. Available:", name);
+        for (guint i = 0; i < G_N_ELEMENTS(benchmarks); i++) {
+            fprintf(stderr, " %s", benchmarks[i].name);
+        }
+        fprintf(stderr, " all\n");
+        return 1;
+    }
+    return 0;
+}
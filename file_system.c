@@ -1,7 +1,103 @@
 #include <gtk/gtk.h>
-#include <sys/statvfs.h>
 #include <stdio.h>
 
+#include "sampler.h"
+
+#define FILE_SYSTEM_INTERVAL_MS 5000
+
+// The tab is rebuilt on every visit; these belong to the one on screen
+static GtkListStore *file_system_store = NULL;
+static guint file_system_listener_id = 0;
+static guint file_system_subscription = 0;
+
+static void set_file_system_row(GtkTreeIter *iter, const FileSystemSample *fs) {
+  const gfloat gib = 1024.0f * 1024.0f * 1024.0f;
+  gfloat total = fs->total / gib;
+  gfloat free = fs->free / gib;
+  gfloat used = total - free;
+  gfloat available = fs->available / gib;
+
+  // Check if total is zero to avoid division by zero
+  gint percentage_used = (total != 0) ? (gint)((used / total) * 100) : 0;
+
+  gchar total_text[32], free_text[32], used_text[64];
+  g_snprintf(total_text, sizeof(total_text), "%.2f GB", total);
+  g_snprintf(free_text, sizeof(free_text), "%.2f GB", free);
+  g_snprintf(used_text, sizeof(used_text), "%.2f GB / %.2f GB", used, available);
+  gtk_list_store_set(file_system_store, iter,
+                     0, fs->device,
+                     1, fs->mount_point,
+                     2, fs->type,
+                     3, total_text,
+                     4, free_text,
+                     5, used_text,
+                     6, percentage_used,
+                     -1);
+}
+
+// Rows are updated in place for as long as the mounts match the previous
+// refresh, keeping the selection and scroll position; from the first
+// difference on they are replaced
+static void apply_file_systems(const GArray *filesystems) {
+  GtkTreeModel *model = GTK_TREE_MODEL(file_system_store);
+  GtkTreeIter iter;
+  gboolean valid = gtk_tree_model_get_iter_first(model, &iter);
+  guint i = 0;
+
+  for (; i < filesystems->len && valid; i++) {
+    const FileSystemSample *fs = &g_array_index(filesystems, FileSystemSample, i);
+    gchar *mount_point;
+    gtk_tree_model_get(model, &iter, 1, &mount_point, -1);
+    gboolean same = g_strcmp0(mount_point, fs->mount_point) == 0;
+    g_free(mount_point);
+    if (!same) {
+      break;
+    }
+    set_file_system_row(&iter, fs);
+    valid = gtk_tree_model_iter_next(model, &iter);
+  }
+
+  while (valid) {
+    valid = gtk_list_store_remove(file_system_store, &iter);
+  }
+  for (; i < filesystems->len; i++) {
+    gtk_list_store_append(file_system_store, &iter);
+    set_file_system_row(&iter, &g_array_index(filesystems, FileSystemSample, i));
+  }
+}
+
+static void on_file_system_snapshot(const Snapshot *snapshot, gpointer user_data) {
+  if ((snapshot->contents & SNAPSHOT_FILESYSTEMS) && file_system_store != NULL) {
+    apply_file_systems(snapshot->filesystems);
+  }
+}
+
+// statvfs() runs on the sampler thread, and only while the list is on screen
+static void on_file_systems_map(GtkWidget *widget, gpointer user_data) {
+  if (file_system_subscription == 0) {
+    file_system_subscription = sampler_subscribe(SAMPLER_FILESYSTEMS, FILE_SYSTEM_INTERVAL_MS);
+  }
+}
+
+static void on_file_systems_unmap(GtkWidget *widget, gpointer user_data) {
+  if (file_system_subscription != 0) {
+    sampler_unsubscribe(file_system_subscription);
+    file_system_subscription = 0;
+  }
+}
+
+static void on_file_systems_destroy(GtkWidget *widget, gpointer user_data) {
+  if (user_data != file_system_store) {
+    return;   // a list replaced before it was destroyed
+  }
+  on_file_systems_unmap(widget, NULL);
+  if (file_system_listener_id != 0) {
+    sampler_remove_listener(file_system_listener_id);
+    file_system_listener_id = 0;
+  }
+  file_system_store = NULL;
+}
+
 void display_file_system_info(GtkWidget *info_box) {
   GtkListStore *store = gtk_list_store_new(7,
                                             G_TYPE_STRING,
@@ -11,40 +107,22 @@ void display_file_system_info(GtkWidget *info_box) {
                                             G_TYPE_STRING,
                                             G_TYPE_STRING,
                                             G_TYPE_INT);
+  file_system_store = store;
 
-  FILE *mntent_file = fopen("/proc/mounts", "r");
-  if (mntent_file != NULL) {
-    char line[1024];
-    while (fgets(line, sizeof(line), mntent_file)) {
-      gchar device[256], mountpoint[256], fstype[256];
-      if (sscanf(line, "%255s %255s %255s %*s %*s %*s", device, mountpoint, fstype) == 3) {
-        struct statvfs vfs;
-        if (statvfs(mountpoint, &vfs) == 0) {
-          gfloat total = (gfloat)vfs.f_blocks * (gfloat)vfs.f_frsize / (1024.0f * 1024.0f * 1024.0f);
-          gfloat free = (gfloat)vfs.f_bfree * (gfloat)vfs.f_frsize / (1024.0f * 1024.0f * 1024.0f);
-          gfloat used = total - free;
-          gfloat available = (gfloat)vfs.f_bavail * (gfloat)vfs.f_frsize / (1024.0f * 1024.0f * 102.0f);
-
-          // Check if total is zero to avoid division by zero
-          gint percentage_used = (total != 0) ? (gint)((used / total) * 100) : 0;
-
-          gtk_list_store_insert_with_values(store, NULL, -1,
-                                            0, device,
-                                            1, mountpoint,
-                                            2, fstype,
-                                            3, g_strdup_printf("%.2f GB", total),
-                                            4, g_strdup_printf("%.2f GB", free),
-                                            5, g_strdup_printf("%.2f GB / %.2f GB", used, available),
-                                            6, percentage_used,
-                                            -1);
-        }
-      }
-    }
-    fclose(mntent_file);
+  // Start from the last reading, if any; subscribing brings a fresh one
+  const Snapshot *latest = sampler_get_latest(SNAPSHOT_FILESYSTEMS);
+  if (latest != NULL) {
+    apply_file_systems(latest->filesystems);
   }
 
   GtkWidget *tree_view = gtk_tree_view_new_with_model(GTK_TREE_MODEL(store));
   g_object_unref(store);
+  if (file_system_listener_id == 0) {
+    file_system_listener_id = sampler_add_listener(on_file_system_snapshot, NULL);
+  }
+  g_signal_connect(tree_view, "map", G_CALLBACK(on_file_systems_map), NULL);
+  g_signal_connect(tree_view, "unmap", G_CALLBACK(on_file_systems_unmap), NULL);
+  g_signal_connect(tree_view, "destroy", G_CALLBACK(on_file_systems_destroy), store);
 
   // Add columns to the GtkTreeView
   GtkCellRenderer *renderer = gtk_cell_renderer_text_new();
@@ -0,0 +1,291 @@
+/*
+ * history.c
+ * Long-horizon store behind the Resources graphs. Every system tick is folded
+ * into three rings of buckets at once (1 s for 10 minutes, 10 s for 6 hours
+ * and 1 min for 7 days), each bucket keeping the min, max and sum of the
+ * samples that fell into it. It listens to the sampler from startup, so the
+ * graphs can show what happened before the tab was opened, and every tick is
+ * also appended to the on-disk journal, which is replayed on the next start.
+ */
+
+#include <glib.h>
+#include <string.h>
+
+#include "history.h"
+#include "journal.h"
+#include "sampler.h"
+
+typedef struct {
+    gfloat min;
+    gfloat max;
+    gfloat sum;
+    guint32 samples;
+} HistoryBucket;
+
+typedef struct {
+    guint seconds;              // width of one bucket
+    guint capacity;             // buckets kept
+    gint64 newest;              // start of the newest bucket, 0 while empty
+    guint head;                 // index of the newest bucket
+    HistoryBucket *buckets[N_HISTORY_SERIES];
+} HistoryTier;
+
+// Main thread only
+static HistoryTier tiers[HISTORY_TIERS] = {
+    { 1, 10 * 60 },
+    { 10, 6 * 360 },
+    { 60, HISTORY_MAX_SPAN / 60 },
+};
+static guint listener_id = 0;
+static guint subscriptions[3];
+
+static void clear_bucket(HistoryTier *tier, guint index) {
+    for (gint series = 0; series < N_HISTORY_SERIES; series++) {
+        memset(&tier->buckets[series][index], 0, sizeof(HistoryBucket));
+    }
+}
+
+// Make bucket_start the newest bucket, emptying the buckets skipped over. A
+// gap longer than the whole ring (suspend, a long stop) starts it afresh.
+static void advance_tier(HistoryTier *tier, gint64 bucket_start) {
+    if (tier->newest == 0 || bucket_start - tier->newest >= (gint64)tier->capacity * tier->seconds) {
+        for (gint series = 0; series < N_HISTORY_SERIES; series++) {
+            memset(tier->buckets[series], 0, tier->capacity * sizeof(HistoryBucket));
+        }
+        tier->head = 0;
+        tier->newest = bucket_start;
+        return;
+    }
+
+    while (tier->newest < bucket_start) {
+        tier->head = (tier->head + 1) % tier->capacity;
+        tier->newest += tier->seconds;
+        clear_bucket(tier, tier->head);
+    }
+}
+
+// Fold one reading of every series, taken at time (seconds since the epoch),
+// into each tier. A reading older than the newest bucket (the clock was set
+// back) is counted in the newest bucket.
+void history_add(gint64 time, const gfloat values[N_HISTORY_SERIES]) {
+    for (guint t = 0; t < HISTORY_TIERS; t++) {
+        HistoryTier *tier = &tiers[t];
+        if (tier->buckets[0] == NULL) {
+            return;
+        }
+
+        gint64 bucket_start = MAX(time - time % tier->seconds, tier->newest);
+        advance_tier(tier, bucket_start);
+
+        for (gint series = 0; series < N_HISTORY_SERIES; series++) {
+            HistoryBucket *bucket = &tier->buckets[series][tier->head];
+            if (bucket->samples == 0) {
+                bucket->min = bucket->max = values[series];
+            } else {
+                bucket->min = MIN(bucket->min, values[series]);
+                bucket->max = MAX(bucket->max, values[series]);
+            }
+            bucket->sum += values[series];
+            bucket->samples++;
+        }
+    }
+}
+
+// Finest tier whose ring reaches back to start, else the coarsest
+static const HistoryTier *pick_tier(gint64 start) {
+    for (guint t = 0; t < HISTORY_TIERS - 1; t++) {
+        const HistoryTier *tier = &tiers[t];
+        if (tier->newest != 0 && tier->newest - (gint64)tier->capacity * tier->seconds <= start) {
+            return tier;
+        }
+    }
+    return &tiers[HISTORY_TIERS - 1];
+}
+
+// Seconds covered by each point of a query from start to end that returns at
+// most max_points (more than 2): buckets of the finest tier reaching back to
+// start, merged in equal groups as needed
+gint64 history_resolution(gint64 start, gint64 end, guint max_points) {
+    const HistoryTier *tier = pick_tier(start);
+    gint64 n_buckets = MAX(end - start, 0) / tier->seconds + 1;
+    return tier->seconds * (n_buckets / (max_points - 2) + 1);
+}
+
+// Fill out with series from start to end (seconds since the epoch), one point
+// per resolution seconds as returned by history_resolution(). Points start at
+// multiples of resolution, so as the range slides with time the points it
+// shares with the previous query stay the same. The coarsest tier whose
+// buckets divide resolution is read, having the same sums over a longer
+// span. Returns the number of points written.
+guint history_query(HistorySeries series, gint64 start, gint64 end, gint64 resolution,
+                    HistoryPoint *out, guint max_points) {
+    const HistoryTier *tier = NULL;
+    for (guint t = HISTORY_TIERS; t-- > 0;) {
+        if (resolution % tiers[t].seconds == 0) {
+            tier = &tiers[t];
+            break;
+        }
+    }
+    if (tier == NULL || tier->buckets[series] == NULL || max_points == 0 || end < start) {
+        return 0;
+    }
+
+    gint64 first = start - start % resolution;
+    guint group = resolution / tier->seconds;
+    guint n_points = MIN((end - first) / resolution + 1, max_points);
+
+    for (guint i = 0; i < n_points; i++) {
+        HistoryPoint *point = &out[i];
+        gfloat sum = 0;
+
+        memset(point, 0, sizeof(*point));
+        point->time = first + (gint64)i * resolution;
+        for (guint j = 0; j < group; j++) {
+            gint64 time = point->time + (gint64)j * tier->seconds;
+            gint64 age = (tier->newest - time) / tier->seconds;
+            if (tier->newest == 0 || time > tier->newest || age >= tier->capacity) {
+                continue;
+            }
+
+            const HistoryBucket *bucket = &tier->buckets[series][(tier->head + tier->capacity - age) % tier->capacity];
+            if (bucket->samples == 0) {
+                continue;
+            }
+            point->min = point->samples == 0 ? bucket->min : MIN(point->min, bucket->min);
+            point->max = point->samples == 0 ? bucket->max : MAX(point->max, bucket->max);
+            point->samples += bucket->samples;
+            sum += bucket->sum;
+        }
+        if (point->samples > 0) {
+            point->avg = sum / point->samples;
+        }
+    }
+    return n_points;
+}
+
+static gfloat used_percent(unsigned long total, unsigned long free) {
+    return total != 0 ? 100.0f * (1.0f - (gfloat)free / total) : 0.0f;
+}
+
+// Keep the busiest processes of columns in record, by CPU then memory
+static void fill_top_processes(JournalRecord *record, const ProcessColumns *columns) {
+    guint n = 0;
+
+    for (guint row = 0; row < columns->len; row++) {
+        gfloat cpu = columns->cpu_usage[row];
+        gfloat memory = columns->memory[row];
+        guint i = n < JOURNAL_TOP_PROCESSES ? n : JOURNAL_TOP_PROCESSES;
+
+        // Insertion into a short sorted array
+        while (i > 0 && (record->processes[i - 1].cpu_usage < cpu ||
+                         (record->processes[i - 1].cpu_usage == cpu && record->processes[i - 1].memory < memory))) {
+            if (i < JOURNAL_TOP_PROCESSES) {
+                record->processes[i] = record->processes[i - 1];
+            }
+            i--;
+        }
+        if (i == JOURNAL_TOP_PROCESSES) {
+            continue;
+        }
+
+        JournalProcess *process = &record->processes[i];
+        process->pid = columns->pid[row];
+        process->cpu_usage = cpu;
+        process->memory = memory;
+        strncpy(process->name, columns->name[row], sizeof(process->name));
+        n = MIN(n + 1, JOURNAL_TOP_PROCESSES);
+    }
+    record->n_processes = n;
+}
+
+// A scan taken more than about two process intervals before now (the
+// Processes tab was closed long ago) says nothing about this tick
+static gboolean is_recent_scan(const Snapshot *processes, gint64 now) {
+    gint64 interval = MAX(processes->process_interval, SAMPLER_PROCESS_INTERVAL_MS);
+    return now - processes->real_time <= 2 * interval * 1000;
+}
+
+static void on_history_snapshot(const Snapshot *snapshot, gpointer user_data) {
+    if (!(snapshot->contents & SNAPSHOT_SYSTEM)) {
+        return;
+    }
+
+    const SystemSample *system = &snapshot->system;
+    gfloat values[N_HISTORY_SERIES];
+    values[HISTORY_CPU] = MAX(system->cpu_usage, 0.0f);
+    values[HISTORY_MEMORY] = used_percent(system->mem_total, system->mem_free);
+    values[HISTORY_SWAP] = used_percent(system->swap_total, system->swap_free);
+    values[HISTORY_RECEIVED] = system->received_rate;
+    values[HISTORY_TRANSMITTED] = system->transmitted_rate;
+
+    gint64 now = snapshot->real_time;
+    history_add(now / G_USEC_PER_SEC, values);
+
+    // The newest process scan, if any view asked for one recently; the
+    // journal does not schedule scans of its own
+    JournalRecord record = { 0 };
+    record.time = now;
+    record.cpu_usage = values[HISTORY_CPU];
+    record.memory = values[HISTORY_MEMORY];
+    record.swap = values[HISTORY_SWAP];
+    record.received_rate = values[HISTORY_RECEIVED];
+    record.transmitted_rate = values[HISTORY_TRANSMITTED];
+    const Snapshot *processes = snapshot->processes != NULL ? snapshot : sampler_get_latest(SNAPSHOT_PROCESSES);
+    if (processes != NULL && processes->processes != NULL && is_recent_scan(processes, now)) {
+        fill_top_processes(&record, processes->processes);
+    }
+    journal_append(&record);
+}
+
+static void replay_record(const JournalRecord *record, gpointer user_data) {
+    gfloat values[N_HISTORY_SERIES];
+    values[HISTORY_CPU] = record->cpu_usage;
+    values[HISTORY_MEMORY] = record->memory;
+    values[HISTORY_SWAP] = record->swap;
+    values[HISTORY_RECEIVED] = record->received_rate;
+    values[HISTORY_TRANSMITTED] = record->transmitted_rate;
+    history_add(record->time / G_USEC_PER_SEC, values);
+}
+
+// Allocate every tier, load the journal of earlier runs and start recording;
+// call after sampler_start()
+void history_start(void) {
+    if (listener_id != 0) {
+        return;
+    }
+    for (guint t = 0; t < HISTORY_TIERS; t++) {
+        for (gint series = 0; series < N_HISTORY_SERIES; series++) {
+            tiers[t].buckets[series] = g_new0(HistoryBucket, tiers[t].capacity);
+        }
+        tiers[t].newest = 0;
+        tiers[t].head = 0;
+    }
+
+    gchar *dir = journal_default_dir();
+    journal_replay(dir, replay_record, NULL);
+    journal_open(dir);
+    g_free(dir);
+
+    listener_id = sampler_add_listener(on_history_snapshot, NULL);
+    subscriptions[0] = sampler_subscribe(SAMPLER_CPU, SAMPLER_INTERVAL_MS);
+    subscriptions[1] = sampler_subscribe(SAMPLER_MEMORY, SAMPLER_INTERVAL_MS);
+    subscriptions[2] = sampler_subscribe(SAMPLER_NETWORK, SAMPLER_INTERVAL_MS);
+}
+
+void history_stop(void) {
+    if (listener_id == 0) {
+        return;
+    }
+    sampler_remove_listener(listener_id);
+    listener_id = 0;
+    for (guint i = 0; i < G_N_ELEMENTS(subscriptions); i++) {
+        sampler_unsubscribe(subscriptions[i]);
+        subscriptions[i] = 0;
+    }
+    journal_close();
+    for (guint t = 0; t < HISTORY_TIERS; t++) {
+        for (gint series = 0; series < N_HISTORY_SERIES; series++) {
+            g_clear_pointer(&tiers[t].buckets[series], g_free);
+        }
+    }
+}
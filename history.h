@@ -0,0 +1,38 @@
+// history.h
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <glib.h>
+
+// System-wide readings kept for the Resources graphs
+typedef enum {
+    HISTORY_CPU,            // percent
+    HISTORY_MEMORY,         // percent
+    HISTORY_SWAP,           // percent
+    HISTORY_RECEIVED,       // all interfaces, bytes/s
+    HISTORY_TRANSMITTED,
+    N_HISTORY_SERIES
+} HistorySeries;
+
+// Resolutions kept, finest first. Memory is fixed: every tier is allocated
+// up front and overwritten in a ring.
+#define HISTORY_TIERS 3
+#define HISTORY_MAX_SPAN (7 * 24 * 3600)   // seconds covered by the coarsest tier
+
+// One bucket of a query; samples is 0 where nothing was recorded
+typedef struct {
+    gint64 time;            // start of the bucket, seconds since the epoch
+    guint samples;
+    gfloat min;
+    gfloat avg;
+    gfloat max;
+} HistoryPoint;
+
+void history_start(void);
+void history_stop(void);
+void history_add(gint64 time, const gfloat values[N_HISTORY_SERIES]);
+gint64 history_resolution(gint64 start, gint64 end, guint max_points);
+guint history_query(HistorySeries series, gint64 start, gint64 end, gint64 resolution,
+                    HistoryPoint *out, guint max_points);
+
+#endif
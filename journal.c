@@ -0,0 +1,239 @@
+/*
+ * journal.c
+ * Append-only on-disk journal of resource samples, so history survives a
+ * restart and the minutes before a crash can be looked at afterwards
+ * (`./mytaskmanager --journal`). The file has a fixed size, is allocated up
+ * front and is mapped shared. A header page is followed by fixed 512-byte
+ * records that never straddle a page, so appending a record dirties a single
+ * page and the kernel writes it back. Nothing is written synchronously. Once
+ * the file is full it becomes journal.1 and a fresh one is started.
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "journal.h"
+
+#define JOURNAL_MAGIC "TMJRNL01"
+#define JOURNAL_HEADER_SIZE 4096
+#define JOURNAL_CAPACITY ((JOURNAL_FILE_SIZE - JOURNAL_HEADER_SIZE) / JOURNAL_RECORD_SIZE)
+#define JOURNAL_NAME "journal"
+#define JOURNAL_PREVIOUS_NAME "journal.1"
+
+typedef struct {
+    char magic[8];
+    guint32 header_size;
+    guint32 record_size;
+    guint32 capacity;
+} JournalHeader;
+
+// Main thread only
+static gchar *journal_path = NULL;
+static int journal_fd = -1;
+static char *journal_map = NULL;
+static guint next_record = 0;
+
+static JournalRecord *record_at(char *map, guint index) {
+    return (JournalRecord *)(map + JOURNAL_HEADER_SIZE + (gsize)index * JOURNAL_RECORD_SIZE);
+}
+
+static void init_header(JournalHeader *header) {
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, JOURNAL_MAGIC, sizeof(header->magic));
+    header->header_size = JOURNAL_HEADER_SIZE;
+    header->record_size = JOURNAL_RECORD_SIZE;
+    header->capacity = JOURNAL_CAPACITY;
+}
+
+// A journal this build can read: same layout and the full size
+static gboolean is_journal(int fd) {
+    JournalHeader header, expected;
+    struct stat st;
+
+    init_header(&expected);
+    return fstat(fd, &st) == 0 && st.st_size == JOURNAL_FILE_SIZE &&
+           pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+           memcmp(&header, &expected, sizeof(header)) == 0;
+}
+
+// Records are appended in order to a zero-filled file, so the used ones form
+// a prefix; bisect on the time field to find its length without a scan
+static guint count_records(char *map) {
+    guint low = 0, high = JOURNAL_CAPACITY;
+    while (low < high) {
+        guint mid = low + (high - low) / 2;
+        if (record_at(map, mid)->time != 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+// Map the current journal for appending, starting it afresh when it is
+// missing or not a journal of this layout
+static gboolean map_current(void) {
+    int fd = open(journal_path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return FALSE;
+    }
+
+    if (!is_journal(fd)) {
+        JournalHeader header;
+        init_header(&header);
+        if (ftruncate(fd, 0) != 0 || ftruncate(fd, JOURNAL_FILE_SIZE) != 0 ||
+            pwrite(fd, &header, sizeof(header), 0) != sizeof(header)) {
+            close(fd);
+            return FALSE;
+        }
+    }
+
+    // Writing through the mapping to a page with no blocks behind it raises
+    // SIGBUS on a full disk, so allocate them all now, while a failure can
+    // still be reported. Journals of earlier runs may still be sparse.
+    int error = posix_fallocate(fd, 0, JOURNAL_FILE_SIZE);
+    if (error != 0) {
+        close(fd);
+        errno = error;
+        return FALSE;
+    }
+
+    char *map = mmap(NULL, JOURNAL_FILE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        return FALSE;
+    }
+
+    journal_fd = fd;
+    journal_map = map;
+    next_record = count_records(map);
+    return TRUE;
+}
+
+static void unmap_current(void) {
+    if (journal_map != NULL) {
+        munmap(journal_map, JOURNAL_FILE_SIZE);
+        journal_map = NULL;
+    }
+    if (journal_fd >= 0) {
+        close(journal_fd);
+        journal_fd = -1;
+    }
+}
+
+// Keep the full journal as the previous one and start a new file
+static gboolean rotate(void) {
+    gchar *dir = g_path_get_dirname(journal_path);
+    gchar *previous = g_build_filename(dir, JOURNAL_PREVIOUS_NAME, NULL);
+
+    unmap_current();
+    gboolean ok = g_rename(journal_path, previous) == 0 && map_current();
+
+    g_free(previous);
+    g_free(dir);
+    return ok;
+}
+
+// Start appending to the journal in dir, picking up where the last run
+// stopped. Returns FALSE (and journals nothing) if it cannot be opened.
+gboolean journal_open(const gchar *dir) {
+    if (journal_map != NULL) {
+        return TRUE;
+    }
+    if (g_mkdir_with_parents(dir, 0700) != 0) {
+        g_warning("Cannot create %s: %s", dir, g_strerror(errno));
+        return FALSE;
+    }
+
+    journal_path = g_build_filename(dir, JOURNAL_NAME, NULL);
+    if (!map_current() || (next_record == JOURNAL_CAPACITY && !rotate())) {
+        g_warning("Cannot open the journal %s: %s", journal_path, g_strerror(errno));
+        journal_close();
+        return FALSE;
+    }
+    return TRUE;
+}
+
+void journal_close(void) {
+    unmap_current();
+    g_clear_pointer(&journal_path, g_free);
+}
+
+// Copy record (whose time must be set) to the end of the journal
+void journal_append(const JournalRecord *record) {
+    if (journal_map == NULL) {
+        return;
+    }
+    if (next_record == JOURNAL_CAPACITY && !rotate()) {
+        g_warning("Cannot rotate the journal: %s", g_strerror(errno));
+        journal_close();
+        return;
+    }
+    memcpy(record_at(journal_map, next_record), record, sizeof(*record));
+    next_record++;
+}
+
+static void replay_file(const gchar *path, JournalFunc func, gpointer user_data) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    if (is_journal(fd)) {
+        char *map = mmap(NULL, JOURNAL_FILE_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+        if (map != MAP_FAILED) {
+            guint n_records = count_records(map);
+            for (guint i = 0; i < n_records; i++) {
+                func(record_at(map, i), user_data);
+            }
+            munmap(map, JOURNAL_FILE_SIZE);
+        }
+    }
+    close(fd);
+}
+
+// Hand every record kept in dir to func, oldest first
+void journal_replay(const gchar *dir, JournalFunc func, gpointer user_data) {
+    gchar *previous = g_build_filename(dir, JOURNAL_PREVIOUS_NAME, NULL);
+    gchar *current = g_build_filename(dir, JOURNAL_NAME, NULL);
+    replay_file(previous, func, user_data);
+    replay_file(current, func, user_data);
+    g_free(current);
+    g_free(previous);
+}
+
+gchar *journal_default_dir(void) {
+    return g_build_filename(g_get_user_data_dir(), "mytaskmanager", NULL);
+}
+
+static void print_record(const JournalRecord *record, gpointer user_data) {
+    FILE *out = user_data;
+    GDateTime *time = g_date_time_new_from_unix_local(record->time / G_USEC_PER_SEC);
+    gchar *time_text = g_date_time_format(time, "%Y-%m-%d %H:%M:%S");
+
+    fprintf(out, "%s cpu %5.1f%% mem %5.1f%% swap %5.1f%% rx %.0f B/s tx %.0f B/s", time_text,
+            record->cpu_usage, record->memory, record->swap, record->received_rate, record->transmitted_rate);
+    for (guint i = 0; i < MIN(record->n_processes, JOURNAL_TOP_PROCESSES); i++) {
+        const JournalProcess *process = &record->processes[i];
+        fprintf(out, " | %.*s[%d] %.1f%% %.0fMiB", (int)sizeof(process->name), process->name,
+                process->pid, process->cpu_usage, process->memory);
+    }
+    fputc('\n', out);
+
+    g_free(time_text);
+    g_date_time_unref(time);
+}
+
+// `./mytaskmanager --journal`: print the journal as text, oldest first
+int journal_print(FILE *out) {
+    gchar *dir = journal_default_dir();
+    journal_replay(dir, print_record, out);
+    g_free(dir);
+    return 0;
+}
@@ -0,0 +1,46 @@
+// journal.h
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <glib.h>
+#include <stdio.h>
+
+#define JOURNAL_RECORD_SIZE 512
+#define JOURNAL_TOP_PROCESSES 14
+#define JOURNAL_FILE_SIZE (16 * 1024 * 1024)   // current file; the previous one is kept as .1
+
+// A process among the busiest at the time of a record
+typedef struct {
+    gint32 pid;
+    gfloat cpu_usage;       // percent of one CPU
+    gfloat memory;          // MiB
+    char name[20];          // truncated comm
+} JournalProcess;
+
+// One tick, stored as is. Records are fixed-size and never straddle a page,
+// so appending one dirties exactly one page of the mapping.
+typedef struct {
+    gint64 time;            // g_get_real_time(); 0 marks the unused tail of a file
+    gfloat cpu_usage;       // percent
+    gfloat memory;          // percent
+    gfloat swap;            // percent
+    gfloat received_rate;   // all interfaces, bytes/s
+    gfloat transmitted_rate;
+    guint32 n_processes;
+    guint32 reserved[8];
+    JournalProcess processes[JOURNAL_TOP_PROCESSES];
+} JournalRecord;
+
+G_STATIC_ASSERT(sizeof(JournalRecord) == JOURNAL_RECORD_SIZE);
+
+// Receives records oldest first
+typedef void (*JournalFunc)(const JournalRecord *record, gpointer user_data);
+
+gboolean journal_open(const gchar *dir);
+void journal_close(void);
+void journal_append(const JournalRecord *record);
+void journal_replay(const gchar *dir, JournalFunc func, gpointer user_data);
+gchar *journal_default_dir(void);
+int journal_print(FILE *out);
+
+#endif
@@ -1,9 +1,22 @@
 #include "app.h"
+#include "history.h"
+#include "journal.h"
+#include "sampler.h"
 #include <gtk/gtk.h>
+#include <string.h>
 
 void on_switch_page(GtkNotebook *notebook, GtkWidget *page, guint page_num, gpointer user_data);
 
 int main(int argc, char *argv[]) {
+    // Headless benchmarks: ./mytaskmanager --bench [name]
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        return run_benchmarks(argc - 2, argv + 2);
+    }
+    // What the journal kept from earlier runs: ./mytaskmanager --journal
+    if (argc > 1 && strcmp(argv[1], "--journal") == 0) {
+        return journal_print(stdout);
+    }
+
     // Initialize GTK
     gtk_init(&argc, &argv);
 
@@ -46,9 +59,17 @@ int main(int argc, char *argv[]) {
     // Show the window
     gtk_widget_show_all(window);
 
+    // Start reading /proc in the background, and keep the readings for the
+    // Resources graphs whether or not the tab is open
+    sampler_start();
+    history_start();
+
     // Start the GTK main loop
     gtk_main();
 
+    history_stop();
+    sampler_stop();
+
     return 0;
 }
 
@@ -57,6 +78,14 @@ void on_switch_page(GtkNotebook *notebook, GtkWidget *page, guint page_num, gpoi
      GtkWidget *current_box = gtk_notebook_get_nth_page(GTK_NOTEBOOK(notebook), page_num);
 
      GList *children = gtk_container_get_children(GTK_CONTAINER(current_box));
+
+    // The process list refreshes itself; keep it (and its selection and
+    // scroll position) instead of rebuilding it on every visit
+    if (page_num == 1 && children != NULL) {
+        g_list_free(children);
+        return;
+    }
+
     for (GList *iter = children; iter != NULL; iter = g_list_next(iter)) {
         gtk_widget_destroy(GTK_WIDGET(iter->data));
     }
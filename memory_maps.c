@@ -0,0 +1,219 @@
+/*
+ * memory_maps.c
+ * Streams /proc/[pid]/smaps into MemoryMap records on a worker thread. The
+ * file is read in fixed chunks and parsed line by line, so a JVM with 50k
+ * mappings never sits in memory as one string; finished mappings are handed
+ * to the main thread in batches, like the open files walk (open_files.c).
+ */
+
+#define _GNU_SOURCE
+#include <glib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "memory_maps.h"
+
+#define MEMORY_MAPS_BATCH 512
+#define SMAPS_CHUNK_SIZE 65536
+#define SMAPS_LINE_MAX 4352     // PATH_MAX plus the address, perms and inode fields
+
+struct _MemoryMapsJob {
+    gint ref_count;
+    gint cancelled;         // set on the main thread; no callbacks after that
+    pid_t pid;
+    MemoryMapsFunc func;
+    gpointer user_data;
+};
+
+typedef struct {
+    MemoryMapsJob *job;
+    GArray *maps;           // MemoryMap
+    gboolean done;
+    gint error;
+} MemoryMapsBatch;
+
+// Parser state carried between lines
+typedef struct {
+    MemoryMapsJob *job;
+    GArray *maps;
+    MemoryMap current;
+    gboolean have_current;
+} SmapsParser;
+
+static void memory_maps_job_unref(MemoryMapsJob *job) {
+    if (g_atomic_int_dec_and_test(&job->ref_count)) {
+        g_free(job);
+    }
+}
+
+static void memory_map_clear(gpointer data) {
+    g_free(((MemoryMap *)data)->path);
+}
+
+static GArray *new_batch_array(void) {
+    GArray *maps = g_array_sized_new(FALSE, FALSE, sizeof(MemoryMap), MEMORY_MAPS_BATCH);
+    g_array_set_clear_func(maps, memory_map_clear);
+    return maps;
+}
+
+static gboolean dispatch_batch(gpointer data) {
+    MemoryMapsBatch *batch = data;
+
+    if (!g_atomic_int_get(&batch->job->cancelled)) {
+        batch->job->func(batch->maps, batch->done, batch->error, batch->job->user_data);
+    }
+    g_array_unref(batch->maps);
+    memory_maps_job_unref(batch->job);
+    g_free(batch);
+    return G_SOURCE_REMOVE;
+}
+
+static void send_batch(MemoryMapsJob *job, GArray **maps, gboolean done, gint error) {
+    MemoryMapsBatch *batch = g_new(MemoryMapsBatch, 1);
+    g_atomic_int_inc(&job->ref_count);
+    batch->job = job;
+    batch->maps = *maps;
+    batch->done = done;
+    batch->error = error;
+    g_idle_add(dispatch_batch, batch);
+    *maps = done ? NULL : new_batch_array();
+}
+
+static void finish_mapping(SmapsParser *parser) {
+    if (!parser->have_current) {
+        return;
+    }
+    g_array_append_val(parser->maps, parser->current);
+    parser->have_current = FALSE;
+    if (parser->maps->len == MEMORY_MAPS_BATCH) {
+        send_batch(parser->job, &parser->maps, FALSE, 0);
+    }
+}
+
+// "7f3a1c000000-7f3a1c021000 rw-p 00000000 00:00 0    [heap]"
+static void parse_header(SmapsParser *parser, const char *line) {
+    gchar *p;
+    MemoryMap *map = &parser->current;
+
+    memset(map, 0, sizeof(*map));
+    map->start = g_ascii_strtoull(line, &p, 16);
+    map->end = g_ascii_strtoull(p + (*p == '-'), &p, 16);
+    while (*p == ' ') {
+        p++;
+    }
+    memcpy(map->perms, p, 4);
+    map->perms[4] = '\0';
+
+    // Skip perms, offset, dev and inode; the rest of the line is the path
+    for (gint field = 0; field < 4 && *p != '\0'; field++) {
+        p += strcspn(p, " ");
+        p += strspn(p, " ");
+    }
+    map->path = g_strdup(p);
+    parser->have_current = TRUE;
+}
+
+// "Rss:                 132 kB"
+static void parse_field(SmapsParser *parser, const char *line) {
+    MemoryMap *map = &parser->current;
+    const char *colon = strchr(line, ':');
+    if (colon == NULL || !parser->have_current) {
+        return;
+    }
+
+    gsize len = colon - line;
+    guint64 value = g_ascii_strtoull(colon + 1, NULL, 10);
+
+#define FIELD_IS(name) (len == sizeof(name) - 1 && memcmp(line, name, len) == 0)
+    if (FIELD_IS("Size")) {
+        map->size = value;
+    } else if (FIELD_IS("Rss")) {
+        map->rss = value;
+    } else if (FIELD_IS("Pss")) {
+        map->pss = value;
+    } else if (FIELD_IS("Swap")) {
+        map->swap = value;
+    } else if (FIELD_IS("Shared_Dirty") || FIELD_IS("Private_Dirty")) {
+        map->dirty += value;
+    }
+#undef FIELD_IS
+}
+
+// Header lines start with the lowercase hex start address, fields with a
+// capitalised key
+static void parse_line(SmapsParser *parser, const char *line) {
+    if (g_ascii_isdigit(*line) || (*line >= 'a' && *line <= 'f')) {
+        finish_mapping(parser);
+        parse_header(parser, line);
+    } else {
+        parse_field(parser, line);
+    }
+}
+
+static gpointer memory_maps_thread(gpointer data) {
+    MemoryMapsJob *job = data;
+    SmapsParser parser = { job, new_batch_array() };
+    gint error = 0;
+    char path[32];
+
+    g_snprintf(path, sizeof(path), "/proc/%d/smaps", (int)job->pid);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = errno;
+    } else {
+        // Lines are assembled in chunk; a partial line is moved to the front
+        // before the next read
+        char *chunk = g_malloc(SMAPS_CHUNK_SIZE + 1);
+        gsize filled = 0;
+        gssize len = 0;
+
+        while (!g_atomic_int_get(&job->cancelled) &&
+               (len = read(fd, chunk + filled, SMAPS_CHUNK_SIZE - filled)) > 0) {
+            char *line = chunk;
+            char *end = chunk + filled + len;
+            char *newline;
+
+            while ((newline = memchr(line, '\n', end - line)) != NULL) {
+                *newline = '\0';
+                parse_line(&parser, line);
+                line = newline + 1;
+            }
+            filled = end - line;
+            if (filled > SMAPS_LINE_MAX) {
+                filled = 0;     // not smaps as we know it; drop the fragment
+            }
+            memmove(chunk, line, filled);
+        }
+        if (len < 0) {
+            error = errno;
+        }
+        g_free(chunk);
+        close(fd);
+        finish_mapping(&parser);
+    }
+
+    send_batch(job, &parser.maps, TRUE, error);
+    memory_maps_job_unref(job);
+    return NULL;
+}
+
+// Start parsing the mappings of pid. func is called from the main loop until
+// the parse is done or the job is cancelled.
+MemoryMapsJob *memory_maps_start(pid_t pid, MemoryMapsFunc func, gpointer user_data) {
+    MemoryMapsJob *job = g_new0(MemoryMapsJob, 1);
+    job->ref_count = 2;     // the caller and the thread
+    job->pid = pid;
+    job->func = func;
+    job->user_data = user_data;
+    g_thread_unref(g_thread_new("memory-maps", memory_maps_thread, job));
+    return job;
+}
+
+// Stop the parse and drop the caller's reference; must be called on the main
+// thread, and func is not called again afterwards
+void memory_maps_cancel(MemoryMapsJob *job) {
+    g_atomic_int_set(&job->cancelled, TRUE);
+    memory_maps_job_unref(job);
+}
@@ -0,0 +1,31 @@
+// memory_maps.h
+#ifndef MEMORY_MAPS_H
+#define MEMORY_MAPS_H
+
+#include <glib.h>
+#include <sys/types.h>
+
+// One mapping of /proc/[pid]/smaps; sizes in kB
+typedef struct {
+    guint64 start;
+    guint64 end;
+    char perms[5];          // "r-xp"
+    gchar *path;            // backing file or [heap], [stack], ...; "" if anonymous
+    guint64 size;
+    guint64 rss;
+    guint64 pss;
+    guint64 swap;
+    guint64 dirty;          // Shared_Dirty + Private_Dirty
+} MemoryMap;
+
+typedef struct _MemoryMapsJob MemoryMapsJob;
+
+// Receives the mappings in batches on the main thread. maps (MemoryMap) is
+// only valid during the call. The last call has done set, and error is the
+// errno that stopped the parse, or 0.
+typedef void (*MemoryMapsFunc)(const GArray *maps, gboolean done, gint error, gpointer user_data);
+
+MemoryMapsJob *memory_maps_start(pid_t pid, MemoryMapsFunc func, gpointer user_data);
+void memory_maps_cancel(MemoryMapsJob *job);
+
+#endif
@@ -0,0 +1,29 @@
+// open_files.h
+#ifndef OPEN_FILES_H
+#define OPEN_FILES_H
+
+#include <glib.h>
+#include <sys/types.h>
+
+// One descriptor of /proc/[pid]/fd
+typedef struct {
+    gint fd;
+    const gchar *type;      // static: "REG", "DIR", "CHR", "FIFO", "TCP", "UNIX", ...
+    gchar *path;            // link target, or a description for resolved sockets
+    guint64 position;       // fdinfo pos
+    guint flags;            // fdinfo flags, O_* bits
+    gboolean has_info;      // position and flags were read
+} OpenFile;
+
+typedef struct _OpenFilesJob OpenFilesJob;
+
+// Receives the descriptors in batches on the main thread. files (OpenFile) is
+// only valid during the call. The last call has done set, and error is the
+// errno that stopped the walk, or 0.
+typedef void (*OpenFilesFunc)(const GArray *files, gboolean done, gint error, gpointer user_data);
+
+OpenFilesJob *open_files_start(pid_t pid, OpenFilesFunc func, gpointer user_data);
+void open_files_cancel(OpenFilesJob *job);
+void open_files_format_flags(guint flags, gchar *buf, gsize size);
+
+#endif
@@ -0,0 +1,362 @@
+/*
+ * proc_events.c
+ * Process lifecycle from the kernel proc connector. When the subscription is
+ * allowed (it needs CAP_NET_ADMIN), a thread receives FORK, EXEC and EXIT
+ * events and keeps the set of live PIDs current, so a process scan can read
+ * the stat files of known PIDs without listing /proc first. Processes that
+ * exit soon after their fork are kept in a small log, as a scan every few
+ * seconds would never show them.
+ *
+ * Events can be lost (the socket buffer overflows on fork storms), so the
+ * set is rebuilt from a readdir() of /proc after an overflow and every
+ * PROC_EVENTS_RECONCILE_SECONDS; without the connector the scan simply lists
+ * /proc every time, as before.
+ */
+
+#define _GNU_SOURCE
+#include <glib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/connector.h>
+#include <linux/cn_proc.h>
+
+#include "proc_events.h"
+
+#define RECEIVE_BUFFER_SIZE 8192
+#define ACK_TIMEOUT_MS 1000
+
+typedef struct {
+    pid_t ppid;
+    gint64 started;                 // g_get_real_time(), 0 if it predates the listing
+    char comm[PROCFS_COMM_LEN];
+} LiveProcess;
+
+static GMutex lock;
+static GThread *thread = NULL;
+static int sock = -1;
+static int wake_pipe[2] = { -1, -1 };
+static GHashTable *live = NULL;     // GINT_TO_POINTER(pid) -> LiveProcess*, under lock
+static gboolean need_reconcile;     // events were lost or never listed, under lock
+static gint64 last_reconcile;       // g_get_monotonic_time(), under lock
+static ShortLivedProcess short_lived[PROC_EVENTS_LOG_SIZE];    // ring, under lock
+static guint short_lived_next;
+static guint short_lived_len;
+
+// Send a PROC_CN_MCAST_* request to the connector
+static gboolean send_mcast_op(enum proc_cn_mcast_op op) {
+    char buf[NLMSG_SPACE(sizeof(struct cn_msg) + sizeof(op))] __attribute__((aligned(NLMSG_ALIGNTO)));
+    struct nlmsghdr *header = (struct nlmsghdr *)buf;
+    struct cn_msg *message = NLMSG_DATA(header);
+
+    memset(buf, 0, sizeof(buf));
+    header->nlmsg_len = NLMSG_LENGTH(sizeof(struct cn_msg) + sizeof(op));
+    header->nlmsg_type = NLMSG_DONE;
+    header->nlmsg_pid = getpid();
+    message->id.idx = CN_IDX_PROC;
+    message->id.val = CN_VAL_PROC;
+    message->len = sizeof(op);
+    memcpy(message->data, &op, sizeof(op));
+    return send(sock, buf, header->nlmsg_len, 0) >= 0;
+}
+
+// The kernel acknowledges a listen request with PROC_EVENT_NONE carrying an
+// errno, EPERM without CAP_NET_ADMIN
+static gboolean wait_for_ack(void) {
+    char buf[RECEIVE_BUFFER_SIZE] __attribute__((aligned(NLMSG_ALIGNTO)));
+    struct pollfd pfd = { sock, POLLIN, 0 };
+
+    while (poll(&pfd, 1, ACK_TIMEOUT_MS) > 0) {
+        gssize len = recv(sock, buf, sizeof(buf), 0);
+        if (len <= 0) {
+            return FALSE;
+        }
+        for (struct nlmsghdr *header = (struct nlmsghdr *)buf; NLMSG_OK(header, len);
+             header = NLMSG_NEXT(header, len)) {
+            const struct proc_event *event = (const void *)((struct cn_msg *)NLMSG_DATA(header))->data;
+            if (event->what == PROC_EVENT_NONE) {
+                return event->event_data.ack.err == 0;
+            }
+        }
+    }
+    return FALSE;
+}
+
+static void read_comm(pid_t pid, char *comm) {
+    char path[32];
+    g_snprintf(path, sizeof(path), "/proc/%d/comm", (int)pid);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    gssize len = read(fd, comm, PROCFS_COMM_LEN - 1);
+    close(fd);
+    if (len > 0) {
+        comm[comm[len - 1] == '\n' ? len - 1 : len] = '\0';
+    }
+}
+
+static void handle_fork(pid_t pid, pid_t ppid) {
+    LiveProcess *process = g_new0(LiveProcess, 1);
+    process->ppid = ppid;
+    process->started = g_get_real_time();
+
+    g_mutex_lock(&lock);
+    // A fork inherits the parent's name until it execs
+    LiveProcess *parent = g_hash_table_lookup(live, GINT_TO_POINTER(ppid));
+    if (parent != NULL) {
+        memcpy(process->comm, parent->comm, PROCFS_COMM_LEN);
+    }
+    g_hash_table_replace(live, GINT_TO_POINTER(pid), process);
+    g_mutex_unlock(&lock);
+}
+
+static void handle_exec(pid_t pid) {
+    char comm[PROCFS_COMM_LEN] = "";
+    read_comm(pid, comm);
+
+    g_mutex_lock(&lock);
+    LiveProcess *process = g_hash_table_lookup(live, GINT_TO_POINTER(pid));
+    if (process != NULL && comm[0] != '\0') {
+        memcpy(process->comm, comm, PROCFS_COMM_LEN);
+    }
+    g_mutex_unlock(&lock);
+}
+
+static void handle_exit(pid_t pid, guint exit_code) {
+    ShortLivedProcess entry = { 0 };
+    gint64 now = g_get_real_time();
+    gboolean short_lived_exit = FALSE;
+
+    g_mutex_lock(&lock);
+    LiveProcess *process = g_hash_table_lookup(live, GINT_TO_POINTER(pid));
+    if (process != NULL && process->started != 0 &&
+        now - process->started < PROC_EVENTS_SHORT_LIVED_MS * 1000) {
+        short_lived_exit = TRUE;
+        entry.pid = pid;
+        entry.ppid = process->ppid;
+        memcpy(entry.comm, process->comm, PROCFS_COMM_LEN);
+        entry.started = process->started;
+        entry.exited = now;
+        entry.exit_code = exit_code;
+    }
+    g_hash_table_remove(live, GINT_TO_POINTER(pid));
+    g_mutex_unlock(&lock);
+
+    if (!short_lived_exit) {
+        return;
+    }
+    if (entry.comm[0] == '\0') {
+        // Still a zombie at this point, so /proc usually has the name
+        read_comm(pid, entry.comm);
+    }
+
+    g_mutex_lock(&lock);
+    short_lived[short_lived_next] = entry;
+    short_lived_next = (short_lived_next + 1) % PROC_EVENTS_LOG_SIZE;
+    short_lived_len = MIN(short_lived_len + 1, PROC_EVENTS_LOG_SIZE);
+    g_mutex_unlock(&lock);
+}
+
+static void handle_event(const struct proc_event *event) {
+    switch (event->what) {
+        case PROC_EVENT_FORK:
+            // New threads are forks too; only new thread groups are processes
+            if (event->event_data.fork.child_pid == event->event_data.fork.child_tgid) {
+                handle_fork(event->event_data.fork.child_tgid, event->event_data.fork.parent_tgid);
+            }
+            break;
+        case PROC_EVENT_EXEC:
+            handle_exec(event->event_data.exec.process_tgid);
+            break;
+        case PROC_EVENT_EXIT:
+            if (event->event_data.exit.process_pid == event->event_data.exit.process_tgid) {
+                handle_exit(event->event_data.exit.process_tgid, event->event_data.exit.exit_code);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void mark_lost_events(void) {
+    g_mutex_lock(&lock);
+    need_reconcile = TRUE;
+    g_mutex_unlock(&lock);
+}
+
+static gpointer proc_events_thread(gpointer data) {
+    char buf[RECEIVE_BUFFER_SIZE] __attribute__((aligned(NLMSG_ALIGNTO)));
+    struct pollfd fds[2] = {
+        { sock, POLLIN, 0 },
+        { wake_pipe[0], POLLIN, 0 },
+    };
+
+    for (;;) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (fds[1].revents != 0) {
+            break;
+        }
+        if (fds[0].revents == 0) {
+            continue;
+        }
+
+        gssize len = recv(sock, buf, sizeof(buf), 0);
+        if (len < 0) {
+            if (errno == ENOBUFS) {
+                mark_lost_events();
+            }
+            continue;
+        }
+        for (struct nlmsghdr *header = (struct nlmsghdr *)buf; NLMSG_OK(header, len);
+             header = NLMSG_NEXT(header, len)) {
+            if (header->nlmsg_type == NLMSG_ERROR || header->nlmsg_type == NLMSG_OVERRUN) {
+                mark_lost_events();
+            } else if (header->nlmsg_type != NLMSG_NOOP) {
+                handle_event((const void *)((struct cn_msg *)NLMSG_DATA(header))->data);
+            }
+        }
+    }
+    return NULL;
+}
+
+// Subscribe to process events. Returns FALSE, leaving scans to list /proc,
+// when the connector is missing or not permitted.
+gboolean proc_events_start(void) {
+    struct sockaddr_nl address = { .nl_family = AF_NETLINK, .nl_groups = CN_IDX_PROC };
+
+    if (thread != NULL) {
+        return TRUE;
+    }
+
+    sock = socket(PF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+    if (sock < 0 || bind(sock, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+        !send_mcast_op(PROC_CN_MCAST_LISTEN) || !wait_for_ack() || pipe2(wake_pipe, O_CLOEXEC) != 0) {
+        if (sock >= 0) {
+            close(sock);
+            sock = -1;
+        }
+        return FALSE;
+    }
+
+    live = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+    need_reconcile = TRUE;
+    short_lived_next = short_lived_len = 0;
+    thread = g_thread_new("proc-events", proc_events_thread, NULL);
+    return TRUE;
+}
+
+void proc_events_stop(void) {
+    if (thread == NULL) {
+        return;
+    }
+
+    char byte = 0;
+    if (write(wake_pipe[1], &byte, 1) == 1) {
+        g_thread_join(thread);
+    }
+    thread = NULL;
+
+    send_mcast_op(PROC_CN_MCAST_IGNORE);
+    close(sock);
+    close(wake_pipe[0]);
+    close(wake_pipe[1]);
+    sock = wake_pipe[0] = wake_pipe[1] = -1;
+    g_clear_pointer(&live, g_hash_table_destroy);
+}
+
+gboolean proc_events_active(void) {
+    return thread != NULL;
+}
+
+static gint compare_pids(gconstpointer a, gconstpointer b) {
+    long pid_a = *(const long *)a;
+    long pid_b = *(const long *)b;
+    return (pid_a > pid_b) - (pid_a < pid_b);
+}
+
+// Live PIDs (long, ascending) as tracked from events, or NULL when the caller
+// has to list /proc and pass the result to proc_events_reconcile()
+GArray *proc_events_copy_pids(void) {
+    GArray *pids = NULL;
+    GHashTableIter iter;
+    gpointer key;
+
+    if (thread == NULL) {
+        return NULL;
+    }
+
+    g_mutex_lock(&lock);
+    if (!need_reconcile &&
+        g_get_monotonic_time() - last_reconcile < PROC_EVENTS_RECONCILE_SECONDS * G_USEC_PER_SEC) {
+        pids = g_array_sized_new(FALSE, FALSE, sizeof(long), g_hash_table_size(live));
+        g_hash_table_iter_init(&iter, live);
+        while (g_hash_table_iter_next(&iter, &key, NULL)) {
+            long pid = GPOINTER_TO_INT(key);
+            g_array_append_val(pids, pid);
+        }
+    }
+    g_mutex_unlock(&lock);
+
+    if (pids != NULL) {
+        g_array_sort(pids, compare_pids);
+    }
+    return pids;
+}
+
+// Replace the tracked set with pids (long) listed from /proc, starting at
+// g_get_real_time() listed_at. Processes forked since then are kept, as the
+// listing may have missed them. A process that exited during the listing
+// lingers until the next reconcile; scans just fail to read it.
+void proc_events_reconcile(const GArray *pids, gint64 listed_at) {
+    if (thread == NULL) {
+        return;
+    }
+
+    GHashTable *listed = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+    GHashTableIter iter;
+    gpointer key, value;
+
+    g_mutex_lock(&lock);
+    for (guint i = 0; i < pids->len; i++) {
+        gpointer pid = GINT_TO_POINTER((gint)g_array_index(pids, long, i));
+        LiveProcess *process = NULL;
+        if (!g_hash_table_steal_extended(live, pid, NULL, (gpointer *)&process)) {
+            process = g_new0(LiveProcess, 1);
+        }
+        g_hash_table_insert(listed, pid, process);
+    }
+    g_hash_table_iter_init(&iter, live);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        if (((LiveProcess *)value)->started >= listed_at) {
+            g_hash_table_iter_steal(&iter);
+            g_hash_table_insert(listed, key, value);
+        }
+    }
+    g_hash_table_destroy(live);
+    live = listed;
+    need_reconcile = FALSE;
+    last_reconcile = g_get_monotonic_time();
+    g_mutex_unlock(&lock);
+}
+
+// Copy up to max of the most recent short-lived processes into out, newest
+// first; returns how many were copied
+guint proc_events_get_short_lived(ShortLivedProcess *out, guint max) {
+    g_mutex_lock(&lock);
+    guint n = MIN(max, short_lived_len);
+    for (guint i = 0; i < n; i++) {
+        out[i] = short_lived[(short_lived_next + PROC_EVENTS_LOG_SIZE - 1 - i) % PROC_EVENTS_LOG_SIZE];
+    }
+    g_mutex_unlock(&lock);
+    return n;
+}
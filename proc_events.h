@@ -0,0 +1,32 @@
+// proc_events.h
+#ifndef PROC_EVENTS_H
+#define PROC_EVENTS_H
+
+#include <glib.h>
+#include <sys/types.h>
+
+#include "procfs.h"
+
+#define PROC_EVENTS_LOG_SIZE 256
+#define PROC_EVENTS_SHORT_LIVED_MS 2000     // shorter-lived processes are logged
+#define PROC_EVENTS_RECONCILE_SECONDS 60    // full /proc listing at least this often
+
+// A process that exited within PROC_EVENTS_SHORT_LIVED_MS of its fork, and so
+// was most likely never seen by a scan
+typedef struct {
+    pid_t pid;
+    pid_t ppid;
+    char comm[PROCFS_COMM_LEN];     // name after the last exec, "" if not caught
+    gint64 started;                 // g_get_real_time()
+    gint64 exited;
+    guint exit_code;                // wait() status
+} ShortLivedProcess;
+
+gboolean proc_events_start(void);
+void proc_events_stop(void);
+gboolean proc_events_active(void);
+GArray *proc_events_copy_pids(void);
+void proc_events_reconcile(const GArray *pids, gint64 listed_at);
+guint proc_events_get_short_lived(ShortLivedProcess *out, guint max);
+
+#endif
@@ -0,0 +1,65 @@
+/*
+ * process_details.c
+ * Per-PID detail records for the details dialog. One lookup reads stat,
+ * statm, status and io once each (procfs_read_pid_details()) and keeps the
+ * result, so several readers within max_age share a single set of reads and
+ * CPU usage can be derived from the previous record of the same process.
+ */
+
+#include <glib.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "process_details.h"
+
+static GHashTable *cache = NULL;    // GINT_TO_POINTER(pid) -> ProcessDetails*
+static int proc_fd = -1;
+
+// Details of pid no older than max_age microseconds, re-read if needed.
+// Returns NULL once the process has exited; a reused PID starts a new record.
+// The record stays valid until the next lookup or forget of the same PID.
+const ProcessDetails *process_details_lookup(pid_t pid, gint64 max_age) {
+    gint64 now = g_get_monotonic_time();
+    ProcessDetails *details;
+    ProcDetails proc;
+
+    if (cache == NULL) {
+        cache = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+        proc_fd = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    }
+
+    details = g_hash_table_lookup(cache, GINT_TO_POINTER(pid));
+    if (details != NULL && now - details->updated <= max_age) {
+        return details;
+    }
+
+    if (proc_fd < 0 || !procfs_read_pid_details(proc_fd, pid, &proc)) {
+        g_hash_table_remove(cache, GINT_TO_POINTER(pid));
+        return NULL;
+    }
+
+    gdouble ticks = sysconf(_SC_CLK_TCK);
+    guint64 cpu_time = proc.stat.utime + proc.stat.stime;
+
+    if (details == NULL || details->proc.stat.starttime != proc.stat.starttime) {
+        details = g_new0(ProcessDetails, 1);
+        g_hash_table_replace(cache, GINT_TO_POINTER(pid), details);
+    } else {
+        guint64 previous = details->proc.stat.utime + details->proc.stat.stime;
+        gdouble elapsed = (now - details->updated) / (gdouble)G_USEC_PER_SEC;
+        details->cpu_usage = elapsed > 0 ? (cpu_time - previous) / ticks / elapsed * 100.0 : 0;
+    }
+
+    details->proc = proc;
+    details->updated = now;
+    details->start_time = procfs_boot_time() + (gint64)(proc.stat.starttime / ticks);
+    details->cpu_seconds = cpu_time / ticks;
+    return details;
+}
+
+// Drop the record of pid once nobody shows it any more
+void process_details_forget(pid_t pid) {
+    if (cache != NULL) {
+        g_hash_table_remove(cache, GINT_TO_POINTER(pid));
+    }
+}
@@ -0,0 +1,22 @@
+// process_details.h
+#ifndef PROCESS_DETAILS_H
+#define PROCESS_DETAILS_H
+
+#include <glib.h>
+#include <sys/types.h>
+
+#include "procfs.h"
+
+// Cached detail record of one PID, with the derived values the dialog shows
+typedef struct {
+    ProcDetails proc;
+    gint64 updated;         // g_get_monotonic_time() of the last read
+    gint64 start_time;      // wall clock, seconds since the epoch
+    gdouble cpu_seconds;    // utime + stime
+    gfloat cpu_usage;       // percent of one CPU between the last two reads
+} ProcessDetails;
+
+const ProcessDetails *process_details_lookup(pid_t pid, gint64 max_age);
+void process_details_forget(pid_t pid);
+
+#endif
@@ -0,0 +1,671 @@
+/*
+ * process_model.c
+ * GtkTreeModel that serves process rows straight out of the sampler's
+ * struct-of-arrays snapshot. Nothing is copied into GTK: each row is a small
+ * node holding the PID and its row number in the current snapshot, and cell
+ * values are read from the snapshot columns on demand. A refresh swaps in the
+ * new snapshot and emits row-changed only for rows whose values moved.
+ *
+ * In tree mode nodes hang under the node of their parent PID, so a service
+ * and everything it forked form one subtree with CPU and memory totals. The
+ * hierarchy is patched in place on each refresh: new PIDs are attached under
+ * their parent, reparented ones are moved and exited ones are cut out.
+ */
+
+#include <gtk/gtk.h>
+#include <string.h>
+
+#include "process_model.h"
+#include "procfs.h"
+
+typedef struct _ProcessNode ProcessNode;
+
+struct _ProcessNode {
+    long pid;
+    guint row;              // row in the snapshot this node was last seen in
+    guint index;            // position in parent->children
+    guint generation;       // last refresh that saw this PID
+    gboolean dirty;         // row-changed is due at the end of the refresh
+    gfloat total_cpu;       // this process plus all descendants
+    gfloat total_memory;
+    ProcessNode *parent;    // &model->root for top-level rows
+    GPtrArray *children;    // ProcessNode*, NULL until the first child
+};
+
+struct _ProcessModel {
+    GObject parent_instance;
+
+    gint stamp;
+    gboolean tree;              // nest rows by PPID instead of a flat list
+    ProcessNode root;           // not a row; its children are the top level
+    GHashTable *by_pid;         // GINT_TO_POINTER(pid) -> ProcessNode*
+    const Snapshot *snapshot;   // rows of nodes seen in the current generation
+    const Snapshot *previous;   // rows of nodes not yet reconciled, only during apply
+    guint generation;
+
+    // While exited rows are swept out of one level, gap_parent->children has
+    // a hole [gap_start, gap_end) that does not count towards row positions
+    ProcessNode *gap_parent;
+    guint gap_start;
+    guint gap_end;
+};
+
+static void process_model_tree_model_init(GtkTreeModelIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE(ProcessModel, process_model, G_TYPE_OBJECT,
+                        G_IMPLEMENT_INTERFACE(GTK_TYPE_TREE_MODEL, process_model_tree_model_init))
+
+static guint n_children(ProcessModel *model, const ProcessNode *node) {
+    if (node->children == NULL) {
+        return 0;
+    }
+    if (node == model->gap_parent) {
+        return node->children->len - (model->gap_end - model->gap_start);
+    }
+    return node->children->len;
+}
+
+static guint child_position(ProcessModel *model, const ProcessNode *node) {
+    if (node->parent == model->gap_parent && node->index >= model->gap_end) {
+        return node->index - (model->gap_end - model->gap_start);
+    }
+    return node->index;
+}
+
+static ProcessNode *nth_child(ProcessModel *model, const ProcessNode *parent, guint position) {
+    if (position >= n_children(model, parent)) {
+        return NULL;
+    }
+    if (parent == model->gap_parent && position >= model->gap_start) {
+        position += model->gap_end - model->gap_start;
+    }
+    return g_ptr_array_index(parent->children, position);
+}
+
+static gboolean set_iter(ProcessModel *model, GtkTreeIter *iter, ProcessNode *node) {
+    if (node == NULL) {
+        iter->stamp = 0;
+        return FALSE;
+    }
+    iter->stamp = model->stamp;
+    iter->user_data = node;
+    return TRUE;
+}
+
+static GtkTreePath *node_path(ProcessModel *model, const ProcessNode *node) {
+    GtkTreePath *path = gtk_tree_path_new();
+    for (; node != &model->root; node = node->parent) {
+        gtk_tree_path_prepend_index(path, child_position(model, node));
+    }
+    return path;
+}
+
+// Columns holding the values of node: the new snapshot once the node has been
+// reconciled, the previous one until then
+static const ProcessColumns *node_columns(ProcessModel *model, const ProcessNode *node) {
+    if (node->generation == model->generation) {
+        return model->snapshot->processes;
+    }
+    return model->previous->processes;
+}
+
+static GtkTreeModelFlags process_model_get_flags(GtkTreeModel *tree_model) {
+    if (PROCESS_MODEL(tree_model)->tree) {
+        return GTK_TREE_MODEL_ITERS_PERSIST;
+    }
+    return GTK_TREE_MODEL_LIST_ONLY | GTK_TREE_MODEL_ITERS_PERSIST;
+}
+
+static gint process_model_get_n_columns(GtkTreeModel *tree_model) {
+    return N_PROCESS_COLUMNS;
+}
+
+static GType process_model_get_column_type(GtkTreeModel *tree_model, gint column) {
+    switch (column) {
+        case COLUMN_NAME:
+        case COLUMN_STATUS:
+        case COLUMN_USER:
+            return G_TYPE_STRING;
+        case COLUMN_PID:
+            return G_TYPE_INT;
+        case COLUMN_MEMORY:
+        case COLUMN_CPU:
+        case COLUMN_TREE_CPU:
+        case COLUMN_TREE_MEMORY:
+        case COLUMN_READ_RATE:
+        case COLUMN_WRITE_RATE:
+        case COLUMN_SYSCALL_RATE:
+            return G_TYPE_FLOAT;
+        default:
+            return G_TYPE_INVALID;
+    }
+}
+
+static gboolean process_model_get_iter(GtkTreeModel *tree_model, GtkTreeIter *iter, GtkTreePath *path) {
+    ProcessModel *model = PROCESS_MODEL(tree_model);
+    gint depth = gtk_tree_path_get_depth(path);
+    gint *indices = gtk_tree_path_get_indices(path);
+    ProcessNode *node = &model->root;
+
+    for (gint i = 0; i < depth && node != NULL; i++) {
+        node = indices[i] >= 0 ? nth_child(model, node, indices[i]) : NULL;
+    }
+    return set_iter(model, iter, depth > 0 ? node : NULL);
+}
+
+static GtkTreePath *process_model_get_path(GtkTreeModel *tree_model, GtkTreeIter *iter) {
+    ProcessModel *model = PROCESS_MODEL(tree_model);
+    g_return_val_if_fail(iter->stamp == model->stamp, NULL);
+    return node_path(model, iter->user_data);
+}
+
+// Strings are handed out as static: names live in the snapshot, states and
+// users are static or interned, and GValues from a model are only used
+// transiently (gtk_tree_model_get() copies them).
+static void process_model_get_value(GtkTreeModel *tree_model, GtkTreeIter *iter, gint column, GValue *value) {
+    ProcessModel *model = PROCESS_MODEL(tree_model);
+    g_return_if_fail(iter->stamp == model->stamp);
+
+    const ProcessNode *node = iter->user_data;
+    const ProcessColumns *columns = node_columns(model, node);
+    guint row = node->row;
+
+    g_value_init(value, process_model_get_column_type(tree_model, column));
+    switch (column) {
+        case COLUMN_NAME:
+            g_value_set_static_string(value, columns->name[row]);
+            break;
+        case COLUMN_STATUS:
+            g_value_set_static_string(value, procfs_state_name(columns->state[row]));
+            break;
+        case COLUMN_PID:
+            g_value_set_int(value, (gint)columns->pid[row]);
+            break;
+        case COLUMN_MEMORY:
+            g_value_set_float(value, columns->memory[row]);
+            break;
+        case COLUMN_USER:
+            g_value_set_static_string(value, columns->user[row]);
+            break;
+        case COLUMN_CPU:
+            g_value_set_float(value, columns->cpu_usage[row]);
+            break;
+        case COLUMN_TREE_CPU:
+            g_value_set_float(value, node->total_cpu);
+            break;
+        case COLUMN_TREE_MEMORY:
+            g_value_set_float(value, node->total_memory);
+            break;
+        case COLUMN_READ_RATE:
+            g_value_set_float(value, columns->read_rate[row]);
+            break;
+        case COLUMN_WRITE_RATE:
+            g_value_set_float(value, columns->write_rate[row]);
+            break;
+        case COLUMN_SYSCALL_RATE:
+            g_value_set_float(value, columns->syscall_rate[row]);
+            break;
+        default:
+            break;
+    }
+}
+
+static gboolean process_model_iter_next(GtkTreeModel *tree_model, GtkTreeIter *iter) {
+    ProcessModel *model = PROCESS_MODEL(tree_model);
+    g_return_val_if_fail(iter->stamp == model->stamp, FALSE);
+    ProcessNode *node = iter->user_data;
+    return set_iter(model, iter, nth_child(model, node->parent, child_position(model, node) + 1));
+}
+
+static gboolean process_model_iter_previous(GtkTreeModel *tree_model, GtkTreeIter *iter) {
+    ProcessModel *model = PROCESS_MODEL(tree_model);
+    g_return_val_if_fail(iter->stamp == model->stamp, FALSE);
+    ProcessNode *node = iter->user_data;
+    guint position = child_position(model, node);
+    return set_iter(model, iter, position > 0 ? nth_child(model, node->parent, position - 1) : NULL);
+}
+
+static gboolean process_model_iter_children(GtkTreeModel *tree_model, GtkTreeIter *iter, GtkTreeIter *parent) {
+    ProcessModel *model = PROCESS_MODEL(tree_model);
+    ProcessNode *node = parent != NULL ? parent->user_data : &model->root;
+    return set_iter(model, iter, nth_child(model, node, 0));
+}
+
+static gboolean process_model_iter_has_child(GtkTreeModel *tree_model, GtkTreeIter *iter) {
+    ProcessModel *model = PROCESS_MODEL(tree_model);
+    return n_children(model, iter->user_data) > 0;
+}
+
+static gint process_model_iter_n_children(GtkTreeModel *tree_model, GtkTreeIter *iter) {
+    ProcessModel *model = PROCESS_MODEL(tree_model);
+    return (gint)n_children(model, iter != NULL ? iter->user_data : &model->root);
+}
+
+static gboolean process_model_iter_nth_child(GtkTreeModel *tree_model, GtkTreeIter *iter,
+                                             GtkTreeIter *parent, gint n) {
+    ProcessModel *model = PROCESS_MODEL(tree_model);
+    ProcessNode *node = parent != NULL ? parent->user_data : &model->root;
+    return set_iter(model, iter, n >= 0 ? nth_child(model, node, n) : NULL);
+}
+
+static gboolean process_model_iter_parent(GtkTreeModel *tree_model, GtkTreeIter *iter, GtkTreeIter *child) {
+    ProcessModel *model = PROCESS_MODEL(tree_model);
+    ProcessNode *parent = ((ProcessNode *)child->user_data)->parent;
+    return set_iter(model, iter, parent != &model->root ? parent : NULL);
+}
+
+static void process_model_tree_model_init(GtkTreeModelIface *iface) {
+    iface->get_flags = process_model_get_flags;
+    iface->get_n_columns = process_model_get_n_columns;
+    iface->get_column_type = process_model_get_column_type;
+    iface->get_iter = process_model_get_iter;
+    iface->get_path = process_model_get_path;
+    iface->get_value = process_model_get_value;
+    iface->iter_next = process_model_iter_next;
+    iface->iter_previous = process_model_iter_previous;
+    iface->iter_children = process_model_iter_children;
+    iface->iter_has_child = process_model_iter_has_child;
+    iface->iter_n_children = process_model_iter_n_children;
+    iface->iter_nth_child = process_model_iter_nth_child;
+    iface->iter_parent = process_model_iter_parent;
+}
+
+// Free node and everything below it without emitting signals; the caller
+// has already reported the removal of node itself
+static guint free_subtree(ProcessModel *model, ProcessNode *node) {
+    guint freed = 1;
+
+    if (node->children != NULL) {
+        for (guint i = 0; i < node->children->len; i++) {
+            freed += free_subtree(model, g_ptr_array_index(node->children, i));
+        }
+        g_ptr_array_free(node->children, TRUE);
+    }
+    g_hash_table_remove(model->by_pid, GINT_TO_POINTER(node->pid));
+    g_free(node);
+    return freed;
+}
+
+static void process_model_finalize(GObject *object) {
+    ProcessModel *model = PROCESS_MODEL(object);
+
+    if (model->root.children != NULL) {
+        for (guint i = 0; i < model->root.children->len; i++) {
+            free_subtree(model, g_ptr_array_index(model->root.children, i));
+        }
+        g_ptr_array_free(model->root.children, TRUE);
+    }
+    g_hash_table_destroy(model->by_pid);
+    snapshot_unref(model->snapshot);
+    snapshot_unref(model->previous);
+
+    G_OBJECT_CLASS(process_model_parent_class)->finalize(object);
+}
+
+static void process_model_class_init(ProcessModelClass *klass) {
+    G_OBJECT_CLASS(klass)->finalize = process_model_finalize;
+}
+
+static void process_model_init(ProcessModel *model) {
+    model->stamp = g_random_int();
+    model->by_pid = g_hash_table_new(g_direct_hash, g_direct_equal);
+}
+
+ProcessModel *process_model_new(gboolean tree) {
+    ProcessModel *model = g_object_new(PROCESS_TYPE_MODEL, NULL);
+    model->tree = tree;
+    return model;
+}
+
+static void emit_row_inserted(ProcessModel *model, ProcessNode *node) {
+    GtkTreeIter iter;
+    GtkTreePath *path = node_path(model, node);
+    set_iter(model, &iter, node);
+    gtk_tree_model_row_inserted(GTK_TREE_MODEL(model), path, &iter);
+    gtk_tree_path_free(path);
+}
+
+static void emit_row_changed(ProcessModel *model, ProcessNode *node) {
+    GtkTreeIter iter;
+    GtkTreePath *path = node_path(model, node);
+    set_iter(model, &iter, node);
+    gtk_tree_model_row_changed(GTK_TREE_MODEL(model), path, &iter);
+    gtk_tree_path_free(path);
+}
+
+static void emit_has_child_toggled(ProcessModel *model, ProcessNode *node) {
+    if (node == &model->root) {
+        return;
+    }
+    GtkTreeIter iter;
+    GtkTreePath *path = node_path(model, node);
+    set_iter(model, &iter, node);
+    gtk_tree_model_row_has_child_toggled(GTK_TREE_MODEL(model), path, &iter);
+    gtk_tree_path_free(path);
+}
+
+static void attach_node(ProcessModel *model, ProcessNode *parent, ProcessNode *node) {
+    if (parent->children == NULL) {
+        parent->children = g_ptr_array_new();
+    }
+    node->parent = parent;
+    node->index = parent->children->len;
+    g_ptr_array_add(parent->children, node);
+
+    emit_row_inserted(model, node);
+    if (parent->children->len == 1) {
+        emit_has_child_toggled(model, parent);
+    }
+}
+
+// Move node (with its subtree) under a new parent: views see the old row go
+// and a new one arrive, then learn that it still has children
+static void move_node(ProcessModel *model, ProcessNode *node, ProcessNode *parent) {
+    ProcessNode *old_parent = node->parent;
+    GtkTreePath *path = node_path(model, node);
+
+    g_ptr_array_remove_index(old_parent->children, node->index);
+    for (guint i = node->index; i < old_parent->children->len; i++) {
+        ((ProcessNode *)g_ptr_array_index(old_parent->children, i))->index = i;
+    }
+    gtk_tree_model_row_deleted(GTK_TREE_MODEL(model), path);
+    gtk_tree_path_free(path);
+    if (old_parent->children->len == 0) {
+        emit_has_child_toggled(model, old_parent);
+    }
+
+    attach_node(model, parent, node);
+    if (n_children(model, node) > 0) {
+        emit_has_child_toggled(model, node);
+    }
+}
+
+// Node to hang a process with parent PID ppid under: the top level in flat
+// mode, or when the parent is gone or would become its own descendant
+static ProcessNode *parent_for(ProcessModel *model, long ppid, const ProcessNode *node) {
+    ProcessNode *root = &model->root;
+    if (!model->tree) {
+        return root;
+    }
+
+    ProcessNode *parent = g_hash_table_lookup(model->by_pid, GINT_TO_POINTER(ppid));
+    if (parent == NULL || parent->generation != model->generation) {
+        return root;
+    }
+    if (node != NULL && parent != node->parent) {
+        for (const ProcessNode *p = parent; p != root; p = p->parent) {
+            if (p == node) {
+                return root;
+            }
+        }
+    }
+    return parent;
+}
+
+// Attach a PID that is new in this snapshot. In tree mode a parent that is new
+// as well (forked within the same interval) is attached first.
+static ProcessNode *insert_new_row(ProcessModel *model, guint row, GHashTable *pending, RefreshStats *stats) {
+    const ProcessColumns *columns = model->snapshot->processes;
+    ProcessNode *parent;
+    gpointer parent_row;
+
+    if (pending != NULL) {
+        g_hash_table_remove(pending, GINT_TO_POINTER(columns->pid[row]));
+    }
+    if (pending != NULL &&
+        g_hash_table_lookup_extended(pending, GINT_TO_POINTER(columns->ppid[row]), NULL, &parent_row)) {
+        parent = insert_new_row(model, GPOINTER_TO_UINT(parent_row), pending, stats);
+    } else {
+        parent = parent_for(model, columns->ppid[row], NULL);
+    }
+
+    ProcessNode *node = g_new0(ProcessNode, 1);
+    node->pid = columns->pid[row];
+    node->row = row;
+    node->generation = model->generation;
+    node->total_cpu = columns->cpu_usage[row];
+    node->total_memory = columns->memory[row];
+    g_hash_table_insert(model->by_pid, GINT_TO_POINTER(node->pid), node);
+
+    attach_node(model, parent, node);
+    stats->inserted++;
+    return node;
+}
+
+// Compact one level in a single pass, dropping nodes not seen in this
+// generation together with their subtrees. The hole between the compacted
+// prefix and the unvisited suffix is excluded from row positions, so the
+// model stays consistent across each row-deleted. Live nodes have already
+// been moved out from under exited ones, so subtrees can go silently.
+static void sweep_exited_rows(ProcessModel *model, ProcessNode *parent, RefreshStats *stats) {
+    GPtrArray *children = parent->children;
+    if (children == NULL) {
+        return;
+    }
+
+    guint len = children->len;
+    guint kept = 0;
+    model->gap_parent = parent;
+
+    for (guint i = 0; i < len; i++) {
+        ProcessNode *node = g_ptr_array_index(children, i);
+
+        model->gap_end = i + 1;
+        if (node->generation == model->generation) {
+            node->index = kept;
+            children->pdata[kept++] = node;
+            model->gap_start = kept;
+            continue;
+        }
+        model->gap_start = kept;
+
+        GtkTreePath *path = node_path(model, parent);
+        gtk_tree_path_append_index(path, kept);
+        gtk_tree_model_row_deleted(GTK_TREE_MODEL(model), path);
+        gtk_tree_path_free(path);
+        stats->removed += free_subtree(model, node);
+    }
+
+    // Nodes were freed or moved above; shrink without touching them
+    children->len = kept;
+    model->gap_parent = NULL;
+    model->gap_start = model->gap_end = 0;
+    if (kept == 0 && len > 0) {
+        emit_has_child_toggled(model, parent);
+    }
+
+    for (guint i = 0; i < kept; i++) {
+        sweep_exited_rows(model, g_ptr_array_index(children, i), stats);
+    }
+}
+
+// Recompute subtree totals bottom-up and flush the pending row-changed
+// signals, now that the hierarchy is final
+static void update_totals(ProcessModel *model, ProcessNode *node, RefreshStats *stats) {
+    const ProcessColumns *columns = model->snapshot->processes;
+    gfloat cpu = 0.0, memory = 0.0;
+
+    if (node != &model->root) {
+        cpu = columns->cpu_usage[node->row];
+        memory = columns->memory[node->row];
+    }
+    if (node->children != NULL) {
+        for (guint i = 0; i < node->children->len; i++) {
+            ProcessNode *child = g_ptr_array_index(node->children, i);
+            update_totals(model, child, stats);
+            cpu += child->total_cpu;
+            memory += child->total_memory;
+        }
+    }
+    if (node == &model->root) {
+        return;
+    }
+
+    if (cpu != node->total_cpu || memory != node->total_memory) {
+        node->total_cpu = cpu;
+        node->total_memory = memory;
+        node->dirty = TRUE;
+    }
+    if (node->dirty) {
+        node->dirty = FALSE;
+        emit_row_changed(model, node);
+        stats->updated++;
+    }
+}
+
+// Snapshot columns and row behind iter, for reading cells without a GValue
+const ProcessColumns *process_model_get_row(ProcessModel *model, GtkTreeIter *iter, guint *row) {
+    g_return_val_if_fail(iter->stamp == model->stamp, NULL);
+    const ProcessNode *node = iter->user_data;
+    *row = node->row;
+    return node_columns(model, node);
+}
+
+static gint compare_numbers(gdouble a, gdouble b) {
+    return (a > b) - (a < b);
+}
+
+// Order two rows on the raw value behind column, without formatting or
+// allocating. Names are compared by their rank in the scan when both rows come
+// from the same one; equal keys fall back to the PID so the order is stable.
+gint process_model_compare(ProcessModel *model, GtkTreeIter *a, GtkTreeIter *b, gint column) {
+    g_return_val_if_fail(a->stamp == model->stamp && b->stamp == model->stamp, 0);
+
+    const ProcessNode *node_a = a->user_data;
+    const ProcessNode *node_b = b->user_data;
+    const ProcessColumns *columns_a = node_columns(model, node_a);
+    const ProcessColumns *columns_b = node_columns(model, node_b);
+    guint row_a = node_a->row;
+    guint row_b = node_b->row;
+    gint result = 0;
+
+    switch (column) {
+        case COLUMN_NAME:
+            if (columns_a == columns_b && columns_a->name_rank != NULL) {
+                result = compare_numbers(columns_a->name_rank[columns_a->name_id[row_a]],
+                                         columns_b->name_rank[columns_b->name_id[row_b]]);
+            } else {
+                result = g_ascii_strcasecmp(columns_a->name[row_a], columns_b->name[row_b]);
+            }
+            break;
+        case COLUMN_STATUS:
+            result = compare_numbers(columns_a->state[row_a], columns_b->state[row_b]);
+            break;
+        case COLUMN_USER:
+            if (columns_a->user[row_a] != columns_b->user[row_b]) {
+                result = g_strcmp0(columns_a->user[row_a], columns_b->user[row_b]);
+            }
+            break;
+        case COLUMN_MEMORY:
+            result = compare_numbers(columns_a->memory[row_a], columns_b->memory[row_b]);
+            break;
+        case COLUMN_CPU:
+            result = compare_numbers(columns_a->cpu_usage[row_a], columns_b->cpu_usage[row_b]);
+            break;
+        case COLUMN_TREE_CPU:
+            result = compare_numbers(node_a->total_cpu, node_b->total_cpu);
+            break;
+        case COLUMN_TREE_MEMORY:
+            result = compare_numbers(node_a->total_memory, node_b->total_memory);
+            break;
+        case COLUMN_READ_RATE:
+            result = compare_numbers(columns_a->read_rate[row_a], columns_b->read_rate[row_b]);
+            break;
+        case COLUMN_WRITE_RATE:
+            result = compare_numbers(columns_a->write_rate[row_a], columns_b->write_rate[row_b]);
+            break;
+        case COLUMN_SYSCALL_RATE:
+            result = compare_numbers(columns_a->syscall_rate[row_a], columns_b->syscall_rate[row_b]);
+            break;
+        default:
+            break;
+    }
+
+    if (result == 0) {
+        result = compare_numbers(node_a->pid, node_b->pid);
+    }
+    return result;
+}
+
+static gboolean row_differs(const ProcessColumns *a, guint row_a, const ProcessColumns *b, guint row_b) {
+    return a->state[row_a] != b->state[row_b] ||
+           a->memory[row_a] != b->memory[row_b] ||
+           a->cpu_usage[row_a] != b->cpu_usage[row_b] ||
+           a->read_rate[row_a] != b->read_rate[row_b] ||
+           a->write_rate[row_a] != b->write_rate[row_b] ||
+           a->syscall_rate[row_a] != b->syscall_rate[row_b] ||
+           a->user[row_a] != b->user[row_b] ||
+           strcmp(a->name[row_a], b->name[row_b]) != 0;
+}
+
+// Make snapshot the model's contents. Existing PIDs keep their node (and so
+// their iters, selection and scroll position); only rows whose values changed
+// emit row-changed, new PIDs are attached and exited ones removed. In tree
+// mode PIDs whose parent changed are moved before exited rows are cut out.
+void process_model_apply(ProcessModel *model, const Snapshot *snapshot, RefreshStats *stats) {
+    const ProcessColumns *columns = snapshot->processes;
+    GArray *new_rows = g_array_new(FALSE, FALSE, sizeof(guint));
+    GHashTable *pending = model->tree ? g_hash_table_new(g_direct_hash, g_direct_equal) : NULL;
+    ProcessNode **seen_nodes = model->tree ? g_new0(ProcessNode *, MAX(columns->len, 1)) : NULL;
+    guint existing = g_hash_table_size(model->by_pid);
+    guint seen = 0;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->total = columns->len;
+
+    model->previous = model->snapshot;
+    model->snapshot = snapshot_ref(snapshot);
+    model->generation++;
+
+    // Re-point existing nodes at their new rows
+    for (guint row = 0; row < columns->len; row++) {
+        ProcessNode *node = g_hash_table_lookup(model->by_pid, GINT_TO_POINTER(columns->pid[row]));
+        if (node == NULL) {
+            g_array_append_val(new_rows, row);
+            if (pending != NULL) {
+                g_hash_table_insert(pending, GINT_TO_POINTER(columns->pid[row]), GUINT_TO_POINTER(row));
+            }
+            continue;
+        }
+
+        node->dirty = row_differs(model->previous->processes, node->row, columns, row);
+        node->row = row;
+        node->generation = model->generation;
+        if (seen_nodes != NULL) {
+            seen_nodes[row] = node;
+        }
+        seen++;
+    }
+
+    for (guint i = 0; i < new_rows->len; i++) {
+        guint row = g_array_index(new_rows, guint, i);
+        if (pending == NULL || g_hash_table_contains(pending, GINT_TO_POINTER(columns->pid[row]))) {
+            insert_new_row(model, row, pending, stats);
+        }
+    }
+
+    // Follow reparenting, including orphans of exited processes
+    if (seen_nodes != NULL) {
+        for (guint row = 0; row < columns->len; row++) {
+            ProcessNode *node = seen_nodes[row];
+            if (node == NULL) {
+                continue;
+            }
+            ProcessNode *parent = parent_for(model, columns->ppid[row], node);
+            if (parent != node->parent) {
+                move_node(model, node, parent);
+            }
+        }
+    }
+
+    if (seen < existing) {
+        sweep_exited_rows(model, &model->root, stats);
+    }
+
+    update_totals(model, &model->root, stats);
+
+    g_clear_pointer(&model->previous, snapshot_unref);
+    g_clear_pointer(&pending, g_hash_table_destroy);
+    g_free(seen_nodes);
+    g_array_unref(new_rows);
+}
@@ -0,0 +1,38 @@
+// process_model.h
+#ifndef PROCESS_MODEL_H
+#define PROCESS_MODEL_H
+
+#include <gtk/gtk.h>
+
+#include "sampler.h"
+
+#define COLUMN_NAME 0
+#define COLUMN_STATUS 1
+#define COLUMN_PID 2
+#define COLUMN_MEMORY 3
+#define COLUMN_USER 4
+#define COLUMN_CPU 5
+#define COLUMN_TREE_CPU 6       // CPU % of the process and all its descendants
+#define COLUMN_TREE_MEMORY 7    // MiB of the process and all its descendants
+#define COLUMN_READ_RATE 8       // disk bytes/s, -1 when /proc/[pid]/io is unreadable
+#define COLUMN_WRITE_RATE 9
+#define COLUMN_SYSCALL_RATE 10    // read and write syscalls/s, -1 likewise
+#define N_PROCESS_COLUMNS 11
+
+// How many rows a single refresh touched
+typedef struct {
+    guint total;
+    guint inserted;
+    guint updated;
+    guint removed;
+} RefreshStats;
+
+#define PROCESS_TYPE_MODEL (process_model_get_type())
+G_DECLARE_FINAL_TYPE(ProcessModel, process_model, PROCESS, MODEL, GObject)
+
+ProcessModel *process_model_new(gboolean tree);
+void process_model_apply(ProcessModel *model, const Snapshot *snapshot, RefreshStats *stats);
+const ProcessColumns *process_model_get_row(ProcessModel *model, GtkTreeIter *iter, guint *row);
+gint process_model_compare(ProcessModel *model, GtkTreeIter *a, GtkTreeIter *b, gint column);
+
+#endif
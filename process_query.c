@@ -0,0 +1,304 @@
+/*
+ * process_query.c
+ * Field queries over the process columns of a snapshot. A query is parsed and
+ * compiled once when the search text changes; matching a row is then a few
+ * array reads per term, with no allocation and no GValue traffic. Name and
+ * regex terms run once per distinct name of a scan (see the name index in
+ * ProcessColumns), so a row only looks up the cached result for its name.
+ */
+
+#include <glib.h>
+#include <string.h>
+
+#include "process_query.h"
+
+// Fields in the order terms are evaluated: cheap comparisons first, so that
+// substring and regex terms only run on rows that are still candidates
+typedef enum {
+    QUERY_PID,
+    QUERY_STATE,
+    QUERY_USER,
+    QUERY_MEMORY,
+    QUERY_CPU,
+    QUERY_NAME,
+    QUERY_REGEX,
+} QueryField;
+
+typedef enum {
+    QUERY_EQ,
+    QUERY_LT,
+    QUERY_LE,
+    QUERY_GT,
+    QUERY_GE,
+} QueryOp;
+
+typedef struct {
+    QueryField field;
+    QueryOp op;
+    gdouble number;         // QUERY_PID, QUERY_MEMORY, QUERY_CPU
+    gchar *text;            // QUERY_NAME (lowercase), QUERY_STATE (letters)
+    const gchar *user;      // QUERY_USER, interned like the user column
+    GRegex *regex;          // QUERY_REGEX
+} QueryTerm;
+
+struct _ProcessQuery {
+    gchar *text;
+    GArray *terms;          // QueryTerm, sorted by field
+    guint n_row_terms;      // leading terms tested per row; the rest test the name
+
+    // Result of the name terms for each distinct name of one scan
+    guint name_serial;      // ProcessColumns.serial the results belong to
+    guint8 *name_matches;   // indexed by name id, NULL until first used
+};
+
+G_DEFINE_QUARK(process-query-error-quark, process_query_error)
+
+static void query_term_clear(gpointer data) {
+    QueryTerm *term = data;
+    g_free(term->text);
+    if (term->regex != NULL) {
+        g_regex_unref(term->regex);
+    }
+}
+
+static gint compare_terms(gconstpointer a, gconstpointer b) {
+    return (gint)((const QueryTerm *)a)->field - (gint)((const QueryTerm *)b)->field;
+}
+
+// Split "field<op>value"; returns FALSE for a plain word
+static gboolean split_term(const gchar *token, gchar **field, QueryOp *op, gboolean *regex, const gchar **value) {
+    gsize len = strcspn(token, ":~<>=");
+    const gchar *p = token + len;
+
+    if (*p == '\0' || len == 0) {
+        return FALSE;
+    }
+
+    *regex = *p == '~';
+    switch (*p) {
+        case '<': *op = p[1] == '=' ? QUERY_LE : QUERY_LT; break;
+        case '>': *op = p[1] == '=' ? QUERY_GE : QUERY_GT; break;
+        default:  *op = QUERY_EQ; break;
+    }
+    p += (*op == QUERY_LE || *op == QUERY_GE) ? 2 : 1;
+
+    *field = g_ascii_strdown(token, len);
+    *value = p;
+    return TRUE;
+}
+
+static gboolean parse_number(const gchar *value, gdouble *out) {
+    gchar *end = NULL;
+    *out = g_ascii_strtod(value, &end);
+    return end != value && *end == '\0';
+}
+
+static gboolean compile_term(const gchar *token, QueryTerm *term, GError **error) {
+    gchar *field = NULL;
+    const gchar *value;
+    gboolean regex = FALSE;
+    gboolean ok = TRUE;
+
+    memset(term, 0, sizeof(*term));
+
+    if (!split_term(token, &field, &term->op, &regex, &value)) {
+        term->field = QUERY_NAME;
+        term->text = g_ascii_strdown(token, -1);
+        return TRUE;
+    }
+
+    if (*value == '\0') {
+        g_set_error(error, PROCESS_QUERY_ERROR, PROCESS_QUERY_ERROR_VALUE, "Missing value in '%s'", token);
+        g_free(field);
+        return FALSE;
+    }
+
+    gboolean numeric = strcmp(field, "pid") == 0 || strcmp(field, "mem") == 0 || strcmp(field, "cpu") == 0;
+    gboolean name = strcmp(field, "cmd") == 0 || strcmp(field, "name") == 0;
+
+    if (regex && !name) {
+        g_set_error(error, PROCESS_QUERY_ERROR, PROCESS_QUERY_ERROR_FIELD, "'~' only applies to cmd: '%s'", token);
+        ok = FALSE;
+    } else if (term->op != QUERY_EQ && !numeric) {
+        g_set_error(error, PROCESS_QUERY_ERROR, PROCESS_QUERY_ERROR_FIELD, "'%s' is not a numeric field", field);
+        ok = FALSE;
+    } else if (numeric) {
+        term->field = field[0] == 'p' ? QUERY_PID : field[0] == 'm' ? QUERY_MEMORY : QUERY_CPU;
+        if (!parse_number(value, &term->number)) {
+            g_set_error(error, PROCESS_QUERY_ERROR, PROCESS_QUERY_ERROR_VALUE, "'%s' is not a number", value);
+            ok = FALSE;
+        }
+    } else if (name && regex) {
+        term->field = QUERY_REGEX;
+        term->regex = g_regex_new(value, G_REGEX_OPTIMIZE, 0, error);
+        ok = term->regex != NULL;
+    } else if (name) {
+        term->field = QUERY_NAME;
+        term->text = g_ascii_strdown(value, -1);
+    } else if (strcmp(field, "user") == 0) {
+        term->field = QUERY_USER;
+        term->user = g_intern_string(value);
+    } else if (strcmp(field, "state") == 0) {
+        term->field = QUERY_STATE;
+        term->text = g_strdup(value);
+    } else {
+        g_set_error(error, PROCESS_QUERY_ERROR, PROCESS_QUERY_ERROR_FIELD, "Unknown field '%s'", field);
+        ok = FALSE;
+    }
+
+    g_free(field);
+    return ok;
+}
+
+// Compile text into a query. Returns NULL and sets error if a term is
+// malformed; an empty text gives a query that matches every row.
+ProcessQuery *process_query_new(const gchar *text, GError **error) {
+    ProcessQuery *query = g_new0(ProcessQuery, 1);
+    query->text = g_strdup(text);
+    query->terms = g_array_new(FALSE, FALSE, sizeof(QueryTerm));
+    g_array_set_clear_func(query->terms, query_term_clear);
+
+    gchar **tokens = g_strsplit_set(text, " \t", -1);
+    for (gint i = 0; tokens[i] != NULL; i++) {
+        QueryTerm term;
+        if (*tokens[i] == '\0') {
+            continue;
+        }
+        if (!compile_term(tokens[i], &term, error)) {
+            query_term_clear(&term);
+            g_strfreev(tokens);
+            process_query_free(query);
+            return NULL;
+        }
+        g_array_append_val(query->terms, term);
+    }
+    g_strfreev(tokens);
+
+    g_array_sort(query->terms, compare_terms);
+    while (query->n_row_terms < query->terms->len &&
+           g_array_index(query->terms, QueryTerm, query->n_row_terms).field < QUERY_NAME) {
+        query->n_row_terms++;
+    }
+    return query;
+}
+
+void process_query_free(ProcessQuery *query) {
+    if (query == NULL) {
+        return;
+    }
+    g_array_unref(query->terms);
+    g_free(query->name_matches);
+    g_free(query->text);
+    g_free(query);
+}
+
+const gchar *process_query_get_text(const ProcessQuery *query) {
+    return query->text;
+}
+
+static gboolean compare_number(QueryOp op, gdouble value, gdouble bound) {
+    switch (op) {
+        case QUERY_LT: return value < bound;
+        case QUERY_LE: return value <= bound;
+        case QUERY_GT: return value > bound;
+        case QUERY_GE: return value >= bound;
+        default:       return value == bound;
+    }
+}
+
+static gboolean match_name(const ProcessQuery *query, const ProcessColumns *columns, guint id) {
+    for (guint i = query->n_row_terms; i < query->terms->len; i++) {
+        const QueryTerm *term = &g_array_index(query->terms, QueryTerm, i);
+        gboolean match;
+
+        if (term->field == QUERY_NAME) {
+            match = strstr(columns->name_lower[id], term->text) != NULL;
+        } else {
+            match = g_regex_match(term->regex, columns->name[columns->name_row[id]], 0, NULL);
+        }
+        if (!match) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+// Evaluate the name terms against every distinct name of columns, once per scan
+static void index_names(ProcessQuery *query, const ProcessColumns *columns) {
+    g_free(query->name_matches);
+    query->name_matches = g_new(guint8, MAX(columns->n_names, 1));
+    for (guint id = 0; id < columns->n_names; id++) {
+        query->name_matches[id] = match_name(query, columns, id);
+    }
+    query->name_serial = columns->serial;
+}
+
+gboolean process_query_match(ProcessQuery *query, const ProcessColumns *columns, guint row) {
+    for (guint i = 0; i < query->n_row_terms; i++) {
+        const QueryTerm *term = &g_array_index(query->terms, QueryTerm, i);
+        gboolean match;
+
+        switch (term->field) {
+            case QUERY_PID:
+                match = compare_number(term->op, columns->pid[row], term->number);
+                break;
+            case QUERY_STATE:
+                match = columns->state[row] != '\0' && strchr(term->text, columns->state[row]) != NULL;
+                break;
+            case QUERY_USER:
+                match = columns->user[row] == term->user;
+                break;
+            case QUERY_MEMORY:
+                match = compare_number(term->op, columns->memory[row], term->number);
+                break;
+            case QUERY_CPU:
+                match = compare_number(term->op, columns->cpu_usage[row], term->number);
+                break;
+            default:
+                match = FALSE;
+                break;
+        }
+
+        if (!match) {
+            return FALSE;
+        }
+    }
+
+    if (query->n_row_terms == query->terms->len) {
+        return TRUE;
+    }
+    if (query->name_matches == NULL || query->name_serial != columns->serial) {
+        index_names(query, columns);
+    }
+    return query->name_matches[columns->name_id[row]];
+}
+
+// Set marks[row] (columns->len entries) for every row that match accepts and
+// for each of its ancestors by PPID. A tree of the rows needs all of them to
+// reach the matches, as hiding a row hides everything below it. Each row is
+// marked at most once, so a walk ends at the first ancestor already marked.
+void process_query_mark_tree(const ProcessColumns *columns, ProcessRowFunc match, gpointer user_data,
+                             guint8 *marks) {
+    GHashTable *rows = g_hash_table_new(g_direct_hash, g_direct_equal);    // PID -> row + 1
+
+    memset(marks, 0, columns->len);
+    for (guint row = 0; row < columns->len; row++) {
+        g_hash_table_insert(rows, GINT_TO_POINTER(columns->pid[row]), GUINT_TO_POINTER(row + 1));
+    }
+
+    for (guint row = 0; row < columns->len; row++) {
+        if (marks[row] || !match(columns, row, user_data)) {
+            continue;
+        }
+        for (guint r = row; !marks[r];) {
+            marks[r] = TRUE;
+            guint parent = GPOINTER_TO_UINT(g_hash_table_lookup(rows, GINT_TO_POINTER(columns->ppid[r])));
+            if (parent == 0) {
+                break;
+            }
+            r = parent - 1;
+        }
+    }
+
+    g_hash_table_destroy(rows);
+}
@@ -0,0 +1,39 @@
+// process_query.h
+#ifndef PROCESS_QUERY_H
+#define PROCESS_QUERY_H
+
+#include <glib.h>
+
+#include "sampler.h"
+
+// A compiled search over process rows. The text is split on spaces into terms
+// that must all match:
+//   word          substring of the command name, case-insensitive
+//   user:NAME     owner is exactly NAME
+//   state:LETTERS one-letter state is any of LETTERS (e.g. state:DR)
+//   pid:N         PID, also pid>N, pid<N, ...
+//   mem>N  mem<N  memory in MiB, as in the Memory column (also >=, <=, =)
+//   cpu>N  cpu<N  CPU % (also >=, <=, =)
+//   cmd~REGEX     command name matches a regular expression
+typedef struct _ProcessQuery ProcessQuery;
+
+#define PROCESS_QUERY_ERROR (process_query_error_quark())
+
+typedef enum {
+    PROCESS_QUERY_ERROR_FIELD,      // unknown field name
+    PROCESS_QUERY_ERROR_VALUE,      // missing or malformed value
+} ProcessQueryError;
+
+// Tells whether row of columns passes a filter
+typedef gboolean (*ProcessRowFunc)(const ProcessColumns *columns, guint row, gpointer user_data);
+
+GQuark process_query_error_quark(void);
+
+ProcessQuery *process_query_new(const gchar *text, GError **error);
+void process_query_free(ProcessQuery *query);
+const gchar *process_query_get_text(const ProcessQuery *query);
+gboolean process_query_match(ProcessQuery *query, const ProcessColumns *columns, guint row);
+void process_query_mark_tree(const ProcessColumns *columns, ProcessRowFunc match, gpointer user_data,
+                             guint8 *marks);
+
+#endif
@@ -0,0 +1,26 @@
+// process_signal.h
+#ifndef PROCESS_SIGNAL_H
+#define PROCESS_SIGNAL_H
+
+#include <glib.h>
+#include <sys/types.h>
+
+// A process as the user saw it: the start time tells it apart from a later
+// process that was given the same PID
+typedef struct {
+    pid_t pid;
+    guint64 starttime;      // clock ticks after boot, as in ProcessColumns
+} ProcessTarget;
+
+// Outcome of signalling a batch of targets
+typedef struct {
+    guint sent;
+    guint exited;           // gone, or the PID now belongs to another process
+    guint denied;           // EPERM
+    guint failed;           // any other error
+} SignalSummary;
+
+gint process_signal_send(int proc_fd, const ProcessTarget *target, int signal);
+void process_signal_batch(const GArray *targets, int signal, SignalSummary *summary, GString *errors);
+
+#endif
@@ -6,9 +6,20 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/signal.h>
+#include <sys/wait.h>
 #include <pwd.h>
 #include <ctype.h>
 
+#include "memory_maps.h"
+#include "open_files.h"
+#include "proc_events.h"
+#include "process_details.h"
+#include "process_model.h"
+#include "process_query.h"
+#include "process_signal.h"
+#include "sampler.h"
+#include "user_cache.h"
+
 #ifndef GTK_RESPONSE_USER_START
 #define GTK_RESPONSE_USER_START (GTK_RESPONSE_DELETE_EVENT + 1)
 #endif
@@ -19,21 +30,35 @@
 #define RESPONSE_LIST_MEMORY_MAPS (GTK_RESPONSE_USER_START + 4)
 #define RESPONSE_LIST_OPEN_FILES (GTK_RESPONSE_USER_START + 5)
 
-#define COLUMN_NAME 0
-#define COLUMN_STATUS 1
-#define COLUMN_PID 2
-#define COLUMN_MEMORY 3
-#define COLUMN_USER 4
-
-void add_tree_view_column(GtkWidget *tree_view, const gchar *title, gint column_id);
+#define SEARCH_DEBOUNCE_MS 150
+
+
+static GtkTreeViewColumn *add_tree_view_column(GtkWidget *tree_view, const gchar *title, gint column_id,
+                                               GtkTreeCellDataFunc cell_func, gfloat xalign);
+static void text_cell_data_func(GtkTreeViewColumn *column, GtkCellRenderer *renderer,
+                                GtkTreeModel *model, GtkTreeIter *iter, gpointer user_data);
+static void int_cell_data_func(GtkTreeViewColumn *column, GtkCellRenderer *renderer,
+                               GtkTreeModel *model, GtkTreeIter *iter, gpointer user_data);
+static void float_cell_data_func(GtkTreeViewColumn *column, GtkCellRenderer *renderer,
+                                 GtkTreeModel *model, GtkTreeIter *iter, gpointer user_data);
+static void uint64_cell_data_func(GtkTreeViewColumn *column, GtkCellRenderer *renderer,
+                                  GtkTreeModel *model, GtkTreeIter *iter, gpointer user_data);
+static void byte_rate_cell_data_func(GtkTreeViewColumn *column, GtkCellRenderer *renderer,
+                                     GtkTreeModel *model, GtkTreeIter *iter, gpointer user_data);
+static void call_rate_cell_data_func(GtkTreeViewColumn *column, GtkCellRenderer *renderer,
+                                     GtkTreeModel *model, GtkTreeIter *iter, gpointer user_data);
 void free_process_list(GList *process_list);
 void refresh_process_list(GtkButton *button, gpointer user_data);
 static gchar* get_process_name(pid_t pid);
 static gchar* get_process_status(pid_t pid);
 static gfloat get_process_memory(pid_t pid);
-static gint get_process_cpu(pid_t pid);
 static GtkTreeModelFilter *filter_model = NULL;
 
+// View settings that outlive the tab being rebuilt
+static gboolean only_user_processes = FALSE;
+static gboolean tree_mode = FALSE;
+static guint refresh_interval_ms = SAMPLER_PROCESS_INTERVAL_MS;
+
 typedef struct {
     long pid;             
     gchar *user;          
@@ -45,14 +70,6 @@ typedef struct {
 
 gchar* get_process_user(uid_t uid);
 
-gchar* get_username_from_uid(uid_t uid) {
-    struct passwd *pw = getpwuid(uid);
-    if (pw) {
-        return g_strdup(pw->pw_name);
-    }
-    return g_strdup("Unknown");
-}
-
 gchar* read_line_from_file(const gchar* filepath) {
     gchar *line = NULL;
     size_t len = 0;
@@ -85,131 +102,126 @@ gchar* get_process_user(uid_t uid) {
     }
 }
 
-gboolean get_process_details(long pid, gchar** out_name, gchar** out_status, gfloat* out_memory, gchar** out_user) {
-    gchar *status_path = g_strdup_printf("/proc/%ld/status", pid);
-    gchar *status_contents = NULL;
-    GError *error = NULL;
-
-    // Read the status file for name and status
-    if (!g_file_get_contents(status_path, &status_contents, NULL, &error)) {
-        g_error_free(error);
-        g_free(status_path);
-        return FALSE;
-    }
+// Row filter state shared by the successive models of one view
+typedef struct {
+    ProcessQuery *query;    // compiled search text, NULL when empty or invalid
+    const gchar *user;      // interned name to restrict rows to, or NULL
+    gboolean tree;          // rows are nested by PPID
+    const ProcessColumns *columns;  // scan shown, held by the model
+    guint8 *marks;          // tree mode while filtering: row of columns is kept
+} ProcessFilter;
+
+// One process list: its widgets and the model stack currently behind it.
+// Attached to the tree view as "process-view" and freed with it.
+typedef struct {
+    GtkWidget *tree_view;
+    GtkWidget *search_entry;
+    GtkWidget *status_label;
+    GtkWidget *actions;             // buttons acting on the selection
+    GtkWidget *signal_spin;
+    GtkTreeViewColumn *tree_cpu_column;
+    GtkTreeViewColumn *tree_memory_column;
+    ProcessModel *model;            // held by filter_model
+    GtkTreeModelFilter *filter_model;   // held by the sort model
+    ProcessFilter filter;
+    guint search_source;            // pending debounced refilter
+    guint listener_id;
+    gboolean stale;                 // scans arrived while unmapped
+} ProcessView;
+
+static void process_view_free(gpointer data) {
+    ProcessView *view = data;
+    process_query_free(view->filter.query);
+    g_free(view->filter.marks);
+    g_free(view);
+}
 
-    gchar **lines = g_strsplit(status_contents, "\n", -1);
-    uid_t uid = -1;
-    for (gint i = 0; lines[i] != NULL; i++) {
-        if (g_str_has_prefix(lines[i], "Name:")) {
-            *out_name = g_strdup(g_strstrip(lines[i] + 5));
-        } else if (g_str_has_prefix(lines[i], "State:")) {
-            *out_status = g_strdup(g_strstrip(lines[i] + 6));
-        } else if (g_str_has_prefix(lines[i], "Uid:")) {
-            gchar **tokens = g_strsplit(lines[i], "\t", -1);
-            uid = (uid_t)g_ascii_strtoull(tokens[1], NULL, 10);
-            g_strfreev(tokens);
-        }
+static void update_refresh_status(GtkWidget *status_label, const RefreshStats *stats, guint interval) {
+    if (status_label == NULL) {
+        return;
     }
-    g_strfreev(lines);
-    g_free(status_contents);
-    g_free(status_path);
-
-    // Get the username from UID
-    if (uid != -1) {
-        *out_user = get_username_from_uid(uid);
+    gchar *text;
+    if (interval > refresh_interval_ms) {
+        text = g_strdup_printf("%u processes (%u added, %u updated, %u removed), slowed to every %.0f s",
+                               stats->total, stats->inserted, stats->updated, stats->removed, interval / 1000.0);
     } else {
-        *out_user = g_strdup("Unknown");
+        text = g_strdup_printf("%u processes (%u added, %u updated, %u removed)",
+                               stats->total, stats->inserted, stats->updated, stats->removed);
     }
+    gtk_label_set_text(GTK_LABEL(status_label), text);
+    g_free(text);
+}
 
-    // Memory usage is read from /proc/[pid]/statm
-    gchar *mem_path = g_strdup_printf("/proc/%ld/statm", pid);
-    gchar *mem_contents = NULL;
+static gboolean filter_row_matches(const ProcessColumns *columns, guint row, gpointer data) {
+    ProcessFilter *filter = data;
 
-    if (g_file_get_contents(mem_path, &mem_contents, NULL, NULL)) {
-        long page_size = sysconf(_SC_PAGESIZE); // Get system page size
-        *out_memory = g_ascii_strtoll(mem_contents, NULL, 10) * page_size / 1024.0 / 1024.0; // Convert to MiB
-        g_free(mem_contents);
-    } else {
-        *out_memory = 0.0; // In case of failure to read memory info
+    if (filter->user != NULL && columns->user[row] != filter->user) {
+        return FALSE;
     }
-    g_free(mem_path);
-
-    return TRUE;
+    return filter->query == NULL || process_query_match(filter->query, columns, row);
 }
 
-
-
-void get_process_info(GtkListStore *store, gboolean only_user_processes) {
-    DIR *dir;
-    struct dirent *entry;
-    uid_t user_uid = getuid();
-
-    dir = opendir("/proc");
-    if (dir == NULL) {
-        perror("Failed to open /proc directory");
+// In tree mode a row is kept when it or any descendant matches, as the filter
+// model hides everything below a hidden row. The rows to keep are worked out
+// once per scan and filter change, not per row.
+static void update_tree_marks(ProcessFilter *filter) {
+    g_clear_pointer(&filter->marks, g_free);
+    if (!filter->tree || filter->columns == NULL || (filter->user == NULL && filter->query == NULL)) {
         return;
     }
+    filter->marks = g_new(guint8, MAX(filter->columns->len, 1));
+    process_query_mark_tree(filter->columns, filter_row_matches, filter, filter->marks);
+}
 
-    // Clear existing entries in the list store
-    gtk_list_store_clear(store);
-
-    while ((entry = readdir(dir)) != NULL) {
-        // Only consider numeric directories
-        if (entry->d_type != DT_DIR || !isdigit(entry->d_name[0])) {
-            continue;
-        }
-
-        long pid = strtol(entry->d_name, NULL, 10);
-        gchar *name, *status, *user;
-        gfloat memory;
-        gboolean success = get_process_details(pid, &name, &status, &memory, &user); // Updated to pass user
-
-        // If the details were successfully retrieved, insert them into the store
-        if (success) {
-            gtk_list_store_insert_with_values(store, NULL, -1,
-                                              0, name,
-                                              1, status,
-                                              2, (gint)pid,
-                                              3, memory,
-                                              4, user, // Include user data in the list store
-                                              -1);
-            g_free(name);
-            g_free(status);
-            g_free(user); // Free the user string
-        }
+// Apply a changed search or owner filter to the rows shown
+static void refilter_view(ProcessView *view) {
+    update_tree_marks(&view->filter);
+    gtk_tree_model_filter_refilter(view->filter_model);
+    if (view->filter.tree) {
+        gtk_tree_view_expand_all(GTK_TREE_VIEW(view->tree_view));
     }
-
-    closedir(dir);
 }
 
+// Hand a finished process scan to the model, which re-points its rows at the
+// new snapshot and signals only the rows that changed
+static void apply_process_snapshot(ProcessView *view, const Snapshot *snapshot) {
+    RefreshStats stats;
+
+    view->filter.columns = snapshot->processes;
+    update_tree_marks(&view->filter);
+    process_model_apply(view->model, snapshot, &stats);
+    // A new match may need ancestors that were hidden until now
+    if (view->filter.marks != NULL) {
+        gtk_tree_model_filter_refilter(view->filter_model);
+    }
 
+    update_refresh_status(view->status_label, &stats, snapshot->process_interval);
+    g_debug("Process refresh: %u rows, %u inserted, %u updated, %u removed (scan %" G_GINT64_FORMAT " us)",
+            stats.total, stats.inserted, stats.updated, stats.removed, snapshot->process_scan_time);
+}
 
-// Function to get process information from the /proc filesystem
-GList* get_all_processes(gboolean only_user_processes) {
-    GList *process_list = NULL;
-    GtkListStore *store = gtk_list_store_new(4, G_TYPE_INT, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_FLOAT);
-    
-    get_process_info(store, only_user_processes);
-
-    // Convert GtkListStore to GList
-    GtkTreeIter iter;
-    gboolean valid = gtk_tree_model_get_iter_first(GTK_TREE_MODEL(store), &iter);
-    while (valid) {
-        ProcessInfo *info = g_new0(ProcessInfo, 1);
-        gtk_tree_model_get(GTK_TREE_MODEL(store), &iter,
-                           0, &info->name,
-                           1, &info->status,
-                           2, &info->pid,
-                           3, &info->memory,
-                           -1);
-        process_list = g_list_prepend(process_list, info);
-        valid = gtk_tree_model_iter_next(GTK_TREE_MODEL(store), &iter);
+// Sampler listener: runs on the main loop whenever a snapshot arrives. Scans
+// taken for others while the list is hidden are applied once it is shown.
+static void on_process_snapshot(const Snapshot *snapshot, gpointer user_data) {
+    ProcessView *view = user_data;
+    if (!(snapshot->contents & SNAPSHOT_PROCESSES)) {
+        return;
     }
+    if (!gtk_widget_get_mapped(view->tree_view)) {
+        view->stale = TRUE;
+        return;
+    }
+    apply_process_snapshot(view, snapshot);
+}
 
-    // The store is no longer needed
-    g_object_unref(store);
-
-    return g_list_reverse(process_list);
+static void on_process_view_destroy(GtkWidget *widget, gpointer user_data) {
+    ProcessView *view = user_data;
+    sampler_remove_listener(view->listener_id);
+    view->listener_id = 0;
+    if (view->search_source != 0) {
+        g_source_remove(view->search_source);
+        view->search_source = 0;
+    }
 }
 
 
@@ -255,300 +267,806 @@ static gfloat get_process_memory(pid_t pid) {
     return memory;
 }
 
-static gint get_process_cpu(pid_t pid) {
-    gchar *filepath = g_strdup_printf("/proc/%d/stat", pid);
-    gchar *contents = NULL;
-    g_file_get_contents(filepath, &contents, NULL, NULL);
-    gchar **tokens = g_strsplit(contents, " ", -1);
-    // utime is at position 13 and stime at position 14 in the stat file
-    gint utime = g_ascii_strtoll(tokens[13], NULL, 10);
-    gint stime = g_ascii_strtoll(tokens[14], NULL, 10);
-    g_strfreev(tokens);
-    g_free(contents);
-    g_free(filepath);
-    // This is a simplified representation of the CPU time, not usage percentage
-    return utime + stime;
-}
-
 void show_process_dialog(pid_t pid) {
     // Placeholder for actual implementation
     printf("Dialog for PID %d would be shown here.\n", pid);
 }
 
-// Function to stop a process
-void stop_process(pid_t pid) {
-    if (kill(pid, SIGSTOP) == -1) {
-        perror("Error stopping process");
+// Rows of the details dialog
+enum {
+    DETAIL_NAME,
+    DETAIL_PID,
+    DETAIL_PPID,
+    DETAIL_USER,
+    DETAIL_STATUS,
+    DETAIL_THREADS,
+    DETAIL_STARTED,
+    DETAIL_CPU_TIME,
+    DETAIL_CPU_USAGE,
+    DETAIL_VIRTUAL,
+    DETAIL_RESIDENT,
+    DETAIL_SHARED,
+    DETAIL_PEAK_RESIDENT,
+    DETAIL_SWAP,
+    DETAIL_CONTEXT_SWITCHES,
+    DETAIL_IO_READ,
+    DETAIL_IO_WRITE,
+    N_DETAILS
+};
+
+static const gchar *detail_titles[N_DETAILS] = {
+    "Name", "PID", "Parent PID", "User", "Status", "Threads", "Started", "CPU Time", "CPU Usage",
+    "Virtual Memory", "Resident Memory", "Shared Memory", "Peak Resident", "Swap",
+    "Context Switches", "Disk Read", "Disk Write",
+};
+
+// Columns of the threads list in the details dialog
+enum {
+    THREAD_TID,
+    THREAD_NAME,
+    THREAD_STATE,
+    THREAD_CPU,
+    THREAD_PROCESSOR,
+    THREAD_VOLUNTARY,
+    THREAD_INVOLUNTARY,
+    N_THREAD_COLUMNS
+};
+
+typedef struct {
+    pid_t pid;
+    guint64 starttime;      // tells the process apart from a later one with its PID
+    GtkWidget *values[N_DETAILS];
+    GtkListStore *threads;
+    GHashTable *thread_rows;    // GINT_TO_POINTER(tid) -> GtkTreeIter*
+    guint64 thread_pass;        // bumped per update; rows not seen in a pass are removed
+    guint listener_id;
+} ProcessDetailsView;
+
+// A thread row and the update pass that last saw it
+typedef struct {
+    GtkTreeIter iter;
+    guint64 pass;
+} ThreadRow;
+
+static void set_detail(ProcessDetailsView *view, gint detail, const gchar *format, ...) G_GNUC_PRINTF(3, 4);
+
+static void set_detail(ProcessDetailsView *view, gint detail, const gchar *format, ...) {
+    gchar text[128];
+    va_list args;
+    va_start(args, format);
+    g_vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    gtk_label_set_text(GTK_LABEL(view->values[detail]), text);
+}
+
+// Fill the dialog from the cached record; FALSE once the process has exited
+static gboolean update_process_details(ProcessDetailsView *view) {
+    const ProcessDetails *details = process_details_lookup(view->pid, SAMPLER_INTERVAL_MS * 1000 / 2);
+    gdouble page_mib = sysconf(_SC_PAGESIZE) / 1048576.0;
+
+    if (details == NULL || (view->starttime != 0 && details->proc.stat.starttime != view->starttime)) {
+        set_detail(view, DETAIL_STATUS, "Exited");
+        return FALSE;
+    }
+
+    const ProcDetails *proc = &details->proc;
+    view->starttime = proc->stat.starttime;
+
+    GDateTime *started = g_date_time_new_from_unix_local(details->start_time);
+    gchar *started_text = g_date_time_format(started, "%Y-%m-%d %H:%M:%S");
+    g_date_time_unref(started);
+
+    set_detail(view, DETAIL_NAME, "%s", proc->stat.comm);
+    set_detail(view, DETAIL_PID, "%d", (int)proc->stat.pid);
+    set_detail(view, DETAIL_PPID, "%d", (int)proc->stat.ppid);
+    set_detail(view, DETAIL_USER, "%s", user_cache_lookup(proc->stat.uid));
+    set_detail(view, DETAIL_STATUS, "%s", procfs_state_name(proc->stat.state));
+    set_detail(view, DETAIL_THREADS, "%" G_GINT64_FORMAT, proc->stat.num_threads);
+    set_detail(view, DETAIL_STARTED, "%s", started_text);
+    set_detail(view, DETAIL_CPU_TIME, "%.2f s", details->cpu_seconds);
+    set_detail(view, DETAIL_CPU_USAGE, "%.1f %%", details->cpu_usage);
+    set_detail(view, DETAIL_VIRTUAL, "%.1f MiB", proc->stat.vsize / 1048576.0);
+    set_detail(view, DETAIL_RESIDENT, "%.1f MiB", proc->stat.resident * page_mib);
+    set_detail(view, DETAIL_SHARED, "%.1f MiB", proc->stat.shared * page_mib);
+    set_detail(view, DETAIL_PEAK_RESIDENT, "%.1f MiB", proc->vm_hwm / 1024.0);
+    set_detail(view, DETAIL_SWAP, "%.1f MiB", proc->vm_swap / 1024.0);
+    set_detail(view, DETAIL_CONTEXT_SWITCHES, "%" G_GUINT64_FORMAT " voluntary, %" G_GUINT64_FORMAT " involuntary",
+               proc->voluntary_ctxt_switches, proc->nonvoluntary_ctxt_switches);
+    if (proc->has_io) {
+        set_detail(view, DETAIL_IO_READ, "%.1f MiB in %" G_GUINT64_FORMAT " calls",
+                   proc->io.read_bytes / 1048576.0, proc->io.syscr);
+        set_detail(view, DETAIL_IO_WRITE, "%.1f MiB in %" G_GUINT64_FORMAT " calls",
+                   proc->io.write_bytes / 1048576.0, proc->io.syscw);
     } else {
-        printf("Process %d stopped\n", pid);
+        set_detail(view, DETAIL_IO_READ, "Not permitted");
+        set_detail(view, DETAIL_IO_WRITE, "Not permitted");
     }
+
+    g_free(started_text);
+    return TRUE;
 }
 
-// Function to continue a process
-void continue_process(pid_t pid) {
-    if (kill(pid, SIGCONT) == -1) {
-        perror("Error continuing process");
-    } else {
-        printf("Process %d continued\n", pid);
+static gboolean is_vanished_thread(gpointer key, gpointer value, gpointer user_data) {
+    ThreadRow *row = value;
+    ProcessDetailsView *view = user_data;
+    if (row->pass == view->thread_pass) {
+        return FALSE;
     }
+    gtk_list_store_remove(view->threads, &row->iter);
+    return TRUE;
 }
 
-// Function to kill a process
-void kill_process(pid_t pid) {
-    if (kill(pid, SIGKILL) == -1) {
-        perror("Error killing process");
-    } else {
-        printf("Process %d killed\n", pid);
+// Update the threads list in place: existing rows are set, new threads added
+// and rows of exited threads removed, so the selection and scroll position
+// survive the refresh
+static void update_thread_rows(ProcessDetailsView *view, const ThreadColumns *threads) {
+    view->thread_pass++;
+
+    for (guint i = 0; i < threads->len; i++) {
+        if (threads->pid[i] != view->pid) {
+            continue;
+        }
+
+        gpointer key = GINT_TO_POINTER(threads->tid[i]);
+        ThreadRow *row = g_hash_table_lookup(view->thread_rows, key);
+        if (row == NULL) {
+            row = g_new(ThreadRow, 1);
+            gtk_list_store_insert_with_values(view->threads, &row->iter, -1, THREAD_TID, (gint)threads->tid[i], -1);
+            g_hash_table_insert(view->thread_rows, key, row);
+        }
+        row->pass = view->thread_pass;
+
+        gtk_list_store_set(view->threads, &row->iter,
+                           THREAD_NAME, threads->name[i],
+                           THREAD_STATE, procfs_state_name(threads->state[i]),
+                           THREAD_CPU, threads->cpu_usage[i],
+                           THREAD_PROCESSOR, threads->processor[i],
+                           THREAD_VOLUNTARY, threads->voluntary_switches[i],
+                           THREAD_INVOLUNTARY, threads->involuntary_switches[i],
+                           -1);
     }
+
+    g_hash_table_foreach_remove(view->thread_rows, is_vanished_thread, view);
 }
 
-// Helper function to read a line from a file
-static gchar* read_first_line(const gchar* filepath) {
-    FILE *file = fopen(filepath, "r");
-    if (file == NULL) {
-        return NULL;
+// Refresh on every sampler tick while the dialog is open
+static void on_details_snapshot(const Snapshot *snapshot, gpointer user_data) {
+    ProcessDetailsView *view = user_data;
+    if (!update_process_details(view)) {
+        sampler_remove_listener(view->listener_id);
+        view->listener_id = 0;
+        sampler_unwatch_threads(view->pid);
+        return;
     }
-    gchar buffer[256];
-    if (fgets(buffer, sizeof(buffer), file) == NULL) {
-        fclose(file);
-        return NULL;
+    if (snapshot->contents & SNAPSHOT_THREADS) {
+        update_thread_rows(view, snapshot->threads);
     }
-    fclose(file);
-    return g_strdup(buffer);
 }
 
-// Function to get virtual memory
-static gchar* get_virtual_memory(pid_t pid) {
-    gchar *filepath = g_strdup_printf("/proc/%d/statm", pid);
-    gchar *line = read_first_line(filepath);
-    gchar **tokens = g_strsplit(line, " ", -1);
-    gchar *vm = g_strdup(tokens[0]); 
-    g_free(filepath);
-    g_free(line);
-    g_strfreev(tokens);
-    return vm;
+static void process_details_view_free(gpointer data) {
+    ProcessDetailsView *view = data;
+    if (view->listener_id != 0) {
+        sampler_remove_listener(view->listener_id);
+        sampler_unwatch_threads(view->pid);
+    }
+    process_details_forget(view->pid);
+    g_hash_table_destroy(view->thread_rows);
+    g_object_unref(view->threads);
+    g_free(view);
 }
 
-// Function to get resident memory
-static gchar* get_resident_memory(pid_t pid) {
-    gchar *filepath = g_strdup_printf("/proc/%d/statm", pid);
-    gchar *line = read_first_line(filepath);
-    gchar **tokens = g_strsplit(line, " ", -1);
-    gchar *rm = g_strdup(tokens[1]); 
-    g_free(filepath);
-    g_free(line);
-    g_strfreev(tokens);
-    return rm;
-}
+// Sortable list of the threads of the process, busiest first
+static GtkWidget *new_threads_view(ProcessDetailsView *view) {
+    view->threads = gtk_list_store_new(N_THREAD_COLUMNS, G_TYPE_INT, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_FLOAT,
+                                       G_TYPE_INT, G_TYPE_UINT64, G_TYPE_UINT64);
+    view->thread_rows = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+    gtk_tree_sortable_set_sort_column_id(GTK_TREE_SORTABLE(view->threads), THREAD_CPU, GTK_SORT_DESCENDING);
+
+    GtkWidget *tree_view = gtk_tree_view_new_with_model(GTK_TREE_MODEL(view->threads));
+    add_tree_view_column(tree_view, "TID", THREAD_TID, int_cell_data_func, 1.0);
+    add_tree_view_column(tree_view, "Name", THREAD_NAME, text_cell_data_func, 0.0);
+    add_tree_view_column(tree_view, "State", THREAD_STATE, text_cell_data_func, 0.0);
+    add_tree_view_column(tree_view, "CPU %", THREAD_CPU, float_cell_data_func, 1.0);
+    add_tree_view_column(tree_view, "Last CPU", THREAD_PROCESSOR, int_cell_data_func, 1.0);
+    add_tree_view_column(tree_view, "Voluntary", THREAD_VOLUNTARY, uint64_cell_data_func, 1.0);
+    add_tree_view_column(tree_view, "Involuntary", THREAD_INVOLUNTARY, uint64_cell_data_func, 1.0);
 
-// Function to get shared memory
-static gchar* get_shared_memory(pid_t pid) {
-    gchar *filepath = g_strdup_printf("/proc/%d/statm", pid);
-    gchar *line = read_first_line(filepath);
-    gchar **tokens = g_strsplit(line, " ", -1);
-    gchar *sm = g_strdup(tokens[2]); 
-    g_free(filepath);
-    g_free(line);
-    g_strfreev(tokens);
-    return sm;
+    GtkWidget *scrolled_window = gtk_scrolled_window_new(NULL, NULL);
+    gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(scrolled_window), GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
+    gtk_widget_set_size_request(scrolled_window, -1, 200);
+    gtk_container_add(GTK_CONTAINER(scrolled_window), tree_view);
+
+    GtkWidget *expander = gtk_expander_new("Threads");
+    gtk_container_add(GTK_CONTAINER(expander), scrolled_window);
+    return expander;
 }
 
-// Function to get CPU time
-static gchar* get_cpu_time(pid_t pid) {
-    gchar *filepath = g_strdup_printf("/proc/%d/stat", pid);
-    gchar *line = read_first_line(filepath);
-    gchar **tokens = g_strsplit(line, " ", -1);
-    long utime = atol(tokens[13]);
-    long stime = atol(tokens[14]);
-    gchar *cpu_time = g_strdup_printf("%ld", utime + stime); 
-    g_free(filepath);
-    g_free(line);
-    g_strfreev(tokens);
-    return cpu_time;
+// Show everything known about pid, updated live until the dialog is closed
+void show_process_details(pid_t pid) {
+    GtkWidget *dialog = gtk_dialog_new_with_buttons("Process Details", NULL, GTK_DIALOG_MODAL, "_Close", GTK_RESPONSE_CLOSE, NULL);
+    gtk_window_set_default_size(GTK_WINDOW(dialog), 400, 300);
+
+    ProcessDetailsView *view = g_new0(ProcessDetailsView, 1);
+    view->pid = pid;
+
+    GtkWidget *grid = gtk_grid_new();
+    gtk_grid_set_row_spacing(GTK_GRID(grid), 4);
+    gtk_grid_set_column_spacing(GTK_GRID(grid), 12);
+    gtk_container_set_border_width(GTK_CONTAINER(grid), 12);
+    for (gint i = 0; i < N_DETAILS; i++) {
+        GtkWidget *title = gtk_label_new(detail_titles[i]);
+        gtk_widget_set_halign(title, GTK_ALIGN_END);
+        view->values[i] = gtk_label_new("");
+        gtk_widget_set_halign(view->values[i], GTK_ALIGN_START);
+        gtk_label_set_selectable(GTK_LABEL(view->values[i]), TRUE);
+        gtk_grid_attach(GTK_GRID(grid), title, 0, i, 1, 1);
+        gtk_grid_attach(GTK_GRID(grid), view->values[i], 1, i, 1, 1);
+    }
+    GtkWidget *content = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
+    gtk_box_pack_start(GTK_BOX(content), grid, FALSE, FALSE, 0);
+    gtk_box_pack_start(GTK_BOX(content), new_threads_view(view), TRUE, TRUE, 0);
+
+    if (update_process_details(view)) {
+        view->listener_id = sampler_add_listener(on_details_snapshot, view);
+        sampler_watch_threads(pid);
+    }
+    g_object_set_data_full(G_OBJECT(dialog), "process-details-view", view, process_details_view_free);
+    gtk_widget_show_all(dialog);
+
+    // Run the dialog and wait for a response
+    gtk_dialog_run(GTK_DIALOG(dialog));
+    gtk_widget_destroy(dialog);
 }
 
-// Function to get start time
-static gchar* get_start_time(pid_t pid) {
-    gchar *filepath = g_strdup_printf("/proc/%d/stat", pid);
-    gchar *line = read_first_line(filepath);
-    gchar **tokens = g_strsplit(line, " ", -1);
-    long start_time = atol(tokens[21]); 
-    g_free(filepath);
-    g_free(line);
-    g_strfreev(tokens);
-    return g_strdup_printf("%ld", start_time);
+
+// Columns of the open files table
+enum {
+    OPEN_FILE_FD,
+    OPEN_FILE_TYPE,
+    OPEN_FILE_PATH,
+    OPEN_FILE_POSITION,
+    OPEN_FILE_FLAGS,
+    OPEN_FILE_HAS_INFO,
+    N_OPEN_FILE_COLUMNS
+};
+
+typedef struct {
+    GtkListStore *store;
+    GtkWidget *status_label;
+    OpenFilesJob *job;      // NULL once the walk is done
+    guint count;
+} OpenFilesView;
+
+static void open_files_view_free(gpointer data) {
+    OpenFilesView *view = data;
+    if (view->job != NULL) {
+        open_files_cancel(view->job);
+    }
+    g_free(view);
 }
 
+// Append a batch from the walk; the table fills while the walk goes on
+static void on_open_files(const GArray *files, gboolean done, gint error, gpointer user_data) {
+    OpenFilesView *view = user_data;
+    gchar text[128];
+
+    for (guint i = 0; i < files->len; i++) {
+        const OpenFile *file = &g_array_index(files, OpenFile, i);
+        gtk_list_store_insert_with_values(view->store, NULL, -1,
+                                          OPEN_FILE_FD, file->fd,
+                                          OPEN_FILE_TYPE, file->type,
+                                          OPEN_FILE_PATH, file->path,
+                                          OPEN_FILE_POSITION, file->position,
+                                          OPEN_FILE_FLAGS, file->flags,
+                                          OPEN_FILE_HAS_INFO, file->has_info,
+                                          -1);
+    }
+    view->count += files->len;
 
+    if (!done) {
+        g_snprintf(text, sizeof(text), "Reading... %u descriptors", view->count);
+    } else if (error != 0) {
+        g_snprintf(text, sizeof(text), "Cannot list open files: %s", g_strerror(error));
+    } else {
+        g_snprintf(text, sizeof(text), "%u open files", view->count);
+    }
+    gtk_label_set_text(GTK_LABEL(view->status_label), text);
 
+    if (done) {
+        open_files_cancel(view->job);   // nothing left to stop; drops the reference
+        view->job = NULL;
+    }
+}
 
-void show_process_details(GtkTreeModel *model, GtkTreeIter *iter) {
-    gchar *name, *status, *user;
-    gint pid;
-    gfloat memory;
-    gtk_tree_model_get(model, iter, COLUMN_NAME, &name, COLUMN_STATUS, &status, COLUMN_PID, &pid, COLUMN_MEMORY, &memory, COLUMN_USER, &user, -1);
+static void open_file_flags_cell_data_func(GtkTreeViewColumn *column, GtkCellRenderer *renderer,
+                                           GtkTreeModel *model, GtkTreeIter *iter, gpointer user_data) {
+    guint flags;
+    gboolean has_info;
+    gchar text[64] = "";
+    gtk_tree_model_get(model, iter, OPEN_FILE_FLAGS, &flags, OPEN_FILE_HAS_INFO, &has_info, -1);
+    if (has_info) {
+        open_files_format_flags(flags, text, sizeof(text));
+    }
+    g_object_set(renderer, "text", text, NULL);
+}
 
-    // Get additional details
-    gchar *virtual_memory = get_virtual_memory(pid);
-    gchar *resident_memory = get_resident_memory(pid);
-    gchar *shared_memory = get_shared_memory(pid);
-    gchar *cpu_time = get_cpu_time(pid);
-    gchar *start_time = get_start_time(pid);
+static void open_file_position_cell_data_func(GtkTreeViewColumn *column, GtkCellRenderer *renderer,
+                                              GtkTreeModel *model, GtkTreeIter *iter, gpointer user_data) {
+    guint64 position;
+    gboolean has_info;
+    gchar text[24] = "";
+    gtk_tree_model_get(model, iter, OPEN_FILE_POSITION, &position, OPEN_FILE_HAS_INFO, &has_info, -1);
+    if (has_info) {
+        g_snprintf(text, sizeof(text), "%" G_GUINT64_FORMAT, position);
+    }
+    g_object_set(renderer, "text", text, NULL);
+}
 
-    // Ensure the user string is valid UTF-8
-    if (!g_utf8_validate(user, -1, NULL)) {
-        g_free(user);
-        user = g_strdup("Invalid UTF-8");
+static void add_open_file_column(GtkWidget *tree_view, const gchar *title, gint column_id,
+                                 GtkTreeCellDataFunc cell_func, gfloat xalign) {
+    GtkCellRenderer *renderer = gtk_cell_renderer_text_new();
+    GtkTreeViewColumn *column;
+
+    g_object_set(renderer, "xalign", xalign, NULL);
+    if (cell_func != NULL) {
+        column = gtk_tree_view_column_new();
+        gtk_tree_view_column_set_title(column, title);
+        gtk_tree_view_column_pack_start(column, renderer, TRUE);
+        gtk_tree_view_column_set_cell_data_func(column, renderer, cell_func, NULL, NULL);
+    } else {
+        column = gtk_tree_view_column_new_with_attributes(title, renderer, "text", column_id, NULL);
     }
+    gtk_tree_view_column_set_sort_column_id(column, column_id);
+    gtk_tree_view_column_set_resizable(column, TRUE);
+    gtk_tree_view_append_column(GTK_TREE_VIEW(tree_view), column);
+}
 
-    // Create a dialog to display the details
-    GtkWidget *dialog = gtk_dialog_new_with_buttons("Process Details", NULL, GTK_DIALOG_MODAL, "_Close", GTK_RESPONSE_CLOSE, NULL);
-    gtk_window_set_default_size(GTK_WINDOW(dialog), 400, 300);
+// Show the open descriptors of pid. They are read from /proc on a worker
+// thread and streamed into the table; closing the dialog stops the walk.
+void list_open_files(pid_t pid) {
+    gchar *title = g_strdup_printf("Open Files of PID %d", pid);
+    GtkWidget *dialog = gtk_dialog_new_with_buttons(title, NULL, 0, "_Close", GTK_RESPONSE_CLOSE, NULL);
+    g_free(title);
+    gtk_window_set_default_size(GTK_WINDOW(dialog), 800, 500);
+
+    OpenFilesView *view = g_new0(OpenFilesView, 1);
+    view->store = gtk_list_store_new(N_OPEN_FILE_COLUMNS, G_TYPE_INT, G_TYPE_STRING, G_TYPE_STRING,
+                                     G_TYPE_UINT64, G_TYPE_UINT, G_TYPE_BOOLEAN);
+
+    GtkWidget *tree_view = gtk_tree_view_new_with_model(GTK_TREE_MODEL(view->store));
+    g_object_unref(view->store); // Held by the tree view
+    add_open_file_column(tree_view, "FD", OPEN_FILE_FD, NULL, 1.0);
+    add_open_file_column(tree_view, "Type", OPEN_FILE_TYPE, NULL, 0.0);
+    add_open_file_column(tree_view, "Path", OPEN_FILE_PATH, NULL, 0.0);
+    add_open_file_column(tree_view, "Position", OPEN_FILE_POSITION, open_file_position_cell_data_func, 1.0);
+    add_open_file_column(tree_view, "Flags", OPEN_FILE_FLAGS, open_file_flags_cell_data_func, 0.0);
+    gtk_tree_view_set_search_column(GTK_TREE_VIEW(tree_view), OPEN_FILE_PATH);
 
-    // Create a label to show the details
-    gchar *details = g_strdup_printf("Name: %s\nUser: %s\nStatus: %s\nPID: %d\nMemory: %.2f MiB\nVirtual Memory: %s\nResident Memory: %s\nShared Memory: %s\nCPU Time: %s\nStart Time: %s", 
-                                     name, user, status, pid, memory, virtual_memory, resident_memory, shared_memory, cpu_time, start_time);
-    GtkWidget *label = gtk_label_new(details);
-    gtk_box_pack_start(GTK_BOX(gtk_dialog_get_content_area(GTK_DIALOG(dialog))), label, TRUE, TRUE, 0);
-    gtk_widget_show_all(dialog);
+    GtkWidget *scrolled_window = gtk_scrolled_window_new(NULL, NULL);
+    gtk_container_add(GTK_CONTAINER(scrolled_window), tree_view);
+    view->status_label = gtk_label_new("Reading...");
+    gtk_widget_set_halign(view->status_label, GTK_ALIGN_START);
 
-    // Run the dialog and wait for a response
-    gtk_dialog_run(GTK_DIALOG(dialog));
+    GtkWidget *content = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
+    gtk_box_pack_start(GTK_BOX(content), scrolled_window, TRUE, TRUE, 0);
+    gtk_box_pack_start(GTK_BOX(content), view->status_label, FALSE, FALSE, 4);
 
-    // Clean up
-    gtk_widget_destroy(dialog);
-    g_free(details);
-    g_free(name);
-    g_free(status);
-    g_free(user);
-    g_free(virtual_memory);
-    g_free(resident_memory);
-    g_free(shared_memory);
-    g_free(cpu_time);
-    g_free(start_time);
+    view->job = open_files_start(pid, on_open_files, view);
+    g_object_set_data_full(G_OBJECT(dialog), "open-files-view", view, open_files_view_free);
+    g_signal_connect(dialog, "response", G_CALLBACK(gtk_widget_destroy), NULL);
+    gtk_widget_show_all(dialog);
 }
 
+// Columns of the memory map tables; sizes are kB
+enum {
+    MAP_START,
+    MAP_END,
+    MAP_PERMS,
+    MAP_PATH,
+    MAP_SIZE,
+    MAP_RSS,
+    MAP_PSS,
+    MAP_SWAP,
+    MAP_DIRTY,
+    N_MAP_COLUMNS
+};
+
+enum {
+    MAP_FILE_PATH,
+    MAP_FILE_COUNT,
+    MAP_FILE_SIZE,
+    MAP_FILE_RSS,
+    MAP_FILE_PSS,
+    MAP_FILE_SWAP,
+    MAP_FILE_DIRTY,
+    N_MAP_FILE_COLUMNS
+};
+
+// Sums of all mappings of one backing object
+typedef struct {
+    GtkTreeIter iter;       // row in the per-file store
+    gboolean touched;       // changed by the current batch
+    guint count;
+    guint64 size;
+    guint64 rss;
+    guint64 pss;
+    guint64 swap;
+    guint64 dirty;
+} MapFileTotals;
 
-// Function to list open files of a process
-void list_open_files(pid_t pid) {
-    gchar *cmdline = g_strdup_printf("lsof -p %d", pid);
-    gchar *output = NULL;
-    GError *error = NULL;
+typedef struct {
+    GtkListStore *maps_store;
+    GtkListStore *files_store;
+    GHashTable *files;      // path -> MapFileTotals*
+    GPtrArray *touched;     // MapFileTotals* changed by the current batch
+    GtkWidget *status_label;
+    MemoryMapsJob *job;     // NULL once the parse is done
+    guint count;
+    guint64 rss;
+    guint64 pss;
+} MemoryMapsView;
+
+static void memory_maps_view_free(gpointer data) {
+    MemoryMapsView *view = data;
+    if (view->job != NULL) {
+        memory_maps_cancel(view->job);
+    }
+    g_hash_table_destroy(view->files);
+    g_ptr_array_free(view->touched, TRUE);
+    g_free(view);
+}
 
-    // Execute the lsof command and get the output
-    if (!g_spawn_command_line_sync(cmdline, &output, NULL, NULL, &error)) {
-        g_warning("Failed to run lsof: %s", error->message);
-        g_error_free(error);
-        g_free(cmdline);
-        return;
+// Add map to the totals of its backing object; rows are written once per batch
+static void add_to_file_totals(MemoryMapsView *view, const MemoryMap *map) {
+    const gchar *path = map->path[0] != '\0' ? map->path : "[anonymous]";
+    MapFileTotals *totals = g_hash_table_lookup(view->files, path);
+
+    if (totals == NULL) {
+        totals = g_new0(MapFileTotals, 1);
+        gtk_list_store_insert_with_values(view->files_store, &totals->iter, -1, MAP_FILE_PATH, path, -1);
+        g_hash_table_insert(view->files, g_strdup(path), totals);
+    }
+    if (!totals->touched) {
+        totals->touched = TRUE;
+        g_ptr_array_add(view->touched, totals);
     }
-    g_free(cmdline);
+    totals->count++;
+    totals->size += map->size;
+    totals->rss += map->rss;
+    totals->pss += map->pss;
+    totals->swap += map->swap;
+    totals->dirty += map->dirty;
+}
 
-    // Create a dialog to display the open files
-    GtkWidget *dialog = gtk_dialog_new_with_buttons(
-        "Open Files",
-        NULL, // parent window
-        GTK_DIALOG_MODAL,
-        "_Close", GTK_RESPONSE_CLOSE,
-        NULL
-    );
+static void on_memory_maps(const GArray *maps, gboolean done, gint error, gpointer user_data) {
+    MemoryMapsView *view = user_data;
+    gchar text[128];
+
+    for (guint i = 0; i < maps->len; i++) {
+        const MemoryMap *map = &g_array_index(maps, MemoryMap, i);
+        gtk_list_store_insert_with_values(view->maps_store, NULL, -1,
+                                          MAP_START, map->start,
+                                          MAP_END, map->end,
+                                          MAP_PERMS, map->perms,
+                                          MAP_PATH, map->path,
+                                          MAP_SIZE, map->size,
+                                          MAP_RSS, map->rss,
+                                          MAP_PSS, map->pss,
+                                          MAP_SWAP, map->swap,
+                                          MAP_DIRTY, map->dirty,
+                                          -1);
+        add_to_file_totals(view, map);
+        view->rss += map->rss;
+        view->pss += map->pss;
+    }
+    view->count += maps->len;
+
+    for (guint i = 0; i < view->touched->len; i++) {
+        MapFileTotals *totals = g_ptr_array_index(view->touched, i);
+        gtk_list_store_set(view->files_store, &totals->iter,
+                           MAP_FILE_COUNT, totals->count,
+                           MAP_FILE_SIZE, totals->size,
+                           MAP_FILE_RSS, totals->rss,
+                           MAP_FILE_PSS, totals->pss,
+                           MAP_FILE_SWAP, totals->swap,
+                           MAP_FILE_DIRTY, totals->dirty,
+                           -1);
+        totals->touched = FALSE;
+    }
+    g_ptr_array_set_size(view->touched, 0);
 
-    gtk_window_set_default_size(GTK_WINDOW(dialog), 600, 400);
+    if (done && error != 0) {
+        g_snprintf(text, sizeof(text), "Cannot read memory maps: %s", g_strerror(error));
+    } else {
+        g_snprintf(text, sizeof(text), "%s%u mappings, RSS %.1f MiB, PSS %.1f MiB", done ? "" : "Reading... ",
+                   view->count, view->rss / 1024.0, view->pss / 1024.0);
+    }
+    gtk_label_set_text(GTK_LABEL(view->status_label), text);
 
-    // Create a scrolled window with a text view
-    GtkWidget *scrolled_window = gtk_scrolled_window_new(NULL, NULL);
-    GtkWidget *text_view = gtk_text_view_new();
-    gtk_text_view_set_editable(GTK_TEXT_VIEW(text_view), FALSE);
-    gtk_text_view_set_wrap_mode(GTK_TEXT_VIEW(text_view), GTK_WRAP_WORD);
-    gtk_container_add(GTK_CONTAINER(scrolled_window), text_view);
+    if (done) {
+        memory_maps_cancel(view->job);  // nothing left to stop; drops the reference
+        view->job = NULL;
+    }
+}
 
-    // Add the scrolled window to the dialog
-    gtk_box_pack_start(GTK_BOX(gtk_dialog_get_content_area(GTK_DIALOG(dialog))),
-                       scrolled_window, TRUE, TRUE, 0);
+static void map_address_cell_data_func(GtkTreeViewColumn *column, GtkCellRenderer *renderer,
+                                       GtkTreeModel *model, GtkTreeIter *iter, gpointer user_data) {
+    guint64 start, end;
+    gchar text[40];
+    gtk_tree_model_get(model, iter, MAP_START, &start, MAP_END, &end, -1);
+    g_snprintf(text, sizeof(text), "%012" G_GINT64_MODIFIER "x-%012" G_GINT64_MODIFIER "x", start, end);
+    g_object_set(renderer, "text", text, NULL);
+}
 
-    // Set the text buffer of the text view to the output of lsof
-    GtkTextBuffer *buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(text_view));
-    gtk_text_buffer_set_text(buffer, output, -1);
+static void uint64_cell_data_func(GtkTreeViewColumn *column, GtkCellRenderer *renderer,
+                                  GtkTreeModel *model, GtkTreeIter *iter, gpointer user_data) {
+    guint64 value;
+    gchar text[24];
+    gtk_tree_model_get(model, iter, GPOINTER_TO_INT(user_data), &value, -1);
+    g_snprintf(text, sizeof(text), "%" G_GUINT64_FORMAT, value);
+    g_object_set(renderer, "text", text, NULL);
+}
 
-    // Show all widgets in the dialog
-    gtk_widget_show_all(dialog);
+// Fixed-width column, so the view can run in fixed height mode and only
+// measure the rows on screen
+static void add_map_column(GtkWidget *tree_view, const gchar *title, gint column_id, gint width,
+                           GtkTreeCellDataFunc cell_func, gfloat xalign) {
+    GtkCellRenderer *renderer = gtk_cell_renderer_text_new();
+    GtkTreeViewColumn *column;
+
+    g_object_set(renderer, "xalign", xalign, NULL);
+    if (cell_func != NULL) {
+        column = gtk_tree_view_column_new();
+        gtk_tree_view_column_set_title(column, title);
+        gtk_tree_view_column_pack_start(column, renderer, TRUE);
+        gtk_tree_view_column_set_cell_data_func(column, renderer, cell_func, GINT_TO_POINTER(column_id), NULL);
+    } else {
+        column = gtk_tree_view_column_new_with_attributes(title, renderer, "text", column_id, NULL);
+    }
+    gtk_tree_view_column_set_sizing(column, GTK_TREE_VIEW_COLUMN_FIXED);
+    gtk_tree_view_column_set_fixed_width(column, width);
+    gtk_tree_view_column_set_resizable(column, TRUE);
+    gtk_tree_view_column_set_sort_column_id(column, column_id);
+    gtk_tree_view_append_column(GTK_TREE_VIEW(tree_view), column);
+}
 
-    // Run the dialog and wait for the user to respond
-    gtk_dialog_run(GTK_DIALOG(dialog));
+static GtkWidget *new_map_tree_view(GtkListStore *store) {
+    GtkWidget *tree_view = gtk_tree_view_new_with_model(GTK_TREE_MODEL(store));
+    g_object_unref(store); // Held by the tree view
+    return tree_view;
+}
 
-    // Clean up
-    gtk_widget_destroy(dialog);
-    g_free(output);
+static GtkWidget *scrolled(GtkWidget *child) {
+    GtkWidget *scrolled_window = gtk_scrolled_window_new(NULL, NULL);
+    gtk_container_add(GTK_CONTAINER(scrolled_window), child);
+    return scrolled_window;
 }
 
-// Function to list memory maps of a process
+// Show the mappings of pid from /proc/[pid]/smaps, one row per mapping and
+// summed per backing file. The file is parsed on a worker thread and the
+// tables fill as it goes; closing the dialog stops the parse.
 void list_memory_maps(pid_t pid) {
-    gchar *filepath = g_strdup_printf("/proc/%d/maps", pid);
-    gchar *contents = NULL;
-    GError *error = NULL;
+    gchar *title = g_strdup_printf("Memory Maps of PID %d", pid);
+    GtkWidget *dialog = gtk_dialog_new_with_buttons(title, NULL, 0, "_Close", GTK_RESPONSE_CLOSE, NULL);
+    g_free(title);
+    gtk_window_set_default_size(GTK_WINDOW(dialog), 900, 500);
+
+    MemoryMapsView *view = g_new0(MemoryMapsView, 1);
+    view->maps_store = gtk_list_store_new(N_MAP_COLUMNS, G_TYPE_UINT64, G_TYPE_UINT64, G_TYPE_STRING,
+                                          G_TYPE_STRING, G_TYPE_UINT64, G_TYPE_UINT64, G_TYPE_UINT64,
+                                          G_TYPE_UINT64, G_TYPE_UINT64);
+    view->files_store = gtk_list_store_new(N_MAP_FILE_COLUMNS, G_TYPE_STRING, G_TYPE_UINT, G_TYPE_UINT64,
+                                           G_TYPE_UINT64, G_TYPE_UINT64, G_TYPE_UINT64, G_TYPE_UINT64);
+    view->files = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    view->touched = g_ptr_array_new();
+
+    GtkWidget *maps_view = new_map_tree_view(view->maps_store);
+    add_map_column(maps_view, "Address", MAP_START, 230, map_address_cell_data_func, 0.0);
+    add_map_column(maps_view, "Perms", MAP_PERMS, 60, NULL, 0.0);
+    add_map_column(maps_view, "Path", MAP_PATH, 260, NULL, 0.0);
+    add_map_column(maps_view, "Size (kB)", MAP_SIZE, 80, uint64_cell_data_func, 1.0);
+    add_map_column(maps_view, "RSS (kB)", MAP_RSS, 80, uint64_cell_data_func, 1.0);
+    add_map_column(maps_view, "PSS (kB)", MAP_PSS, 80, uint64_cell_data_func, 1.0);
+    add_map_column(maps_view, "Swap (kB)", MAP_SWAP, 80, uint64_cell_data_func, 1.0);
+    add_map_column(maps_view, "Dirty (kB)", MAP_DIRTY, 80, uint64_cell_data_func, 1.0);
+    gtk_tree_view_set_fixed_height_mode(GTK_TREE_VIEW(maps_view), TRUE);
+
+    GtkWidget *files_view = new_map_tree_view(view->files_store);
+    add_map_column(files_view, "Path", MAP_FILE_PATH, 350, NULL, 0.0);
+    add_map_column(files_view, "Mappings", MAP_FILE_COUNT, 80, NULL, 1.0);
+    add_map_column(files_view, "Size (kB)", MAP_FILE_SIZE, 80, uint64_cell_data_func, 1.0);
+    add_map_column(files_view, "RSS (kB)", MAP_FILE_RSS, 80, uint64_cell_data_func, 1.0);
+    add_map_column(files_view, "PSS (kB)", MAP_FILE_PSS, 80, uint64_cell_data_func, 1.0);
+    add_map_column(files_view, "Swap (kB)", MAP_FILE_SWAP, 80, uint64_cell_data_func, 1.0);
+    add_map_column(files_view, "Dirty (kB)", MAP_FILE_DIRTY, 80, uint64_cell_data_func, 1.0);
+    gtk_tree_view_set_fixed_height_mode(GTK_TREE_VIEW(files_view), TRUE);
+
+    GtkWidget *notebook = gtk_notebook_new();
+    gtk_notebook_append_page(GTK_NOTEBOOK(notebook), scrolled(maps_view), gtk_label_new("Mappings"));
+    gtk_notebook_append_page(GTK_NOTEBOOK(notebook), scrolled(files_view), gtk_label_new("By File"));
+    view->status_label = gtk_label_new("Reading...");
+    gtk_widget_set_halign(view->status_label, GTK_ALIGN_START);
+
+    GtkWidget *content = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
+    gtk_box_pack_start(GTK_BOX(content), notebook, TRUE, TRUE, 0);
+    gtk_box_pack_start(GTK_BOX(content), view->status_label, FALSE, FALSE, 4);
+
+    view->job = memory_maps_start(pid, on_memory_maps, view);
+    g_object_set_data_full(G_OBJECT(dialog), "memory-maps-view", view, memory_maps_view_free);
+    g_signal_connect(dialog, "response", G_CALLBACK(gtk_widget_destroy), NULL);
+    gtk_widget_show_all(dialog);
+}
 
-    // Read the contents of the maps file
-    if (!g_file_get_contents(filepath, &contents, NULL, &error)) {
-        g_warning("Failed to read memory maps: %s", error->message);
-        g_error_free(error);
-        g_free(filepath);
-        return;
-    }
-    g_free(filepath);
 
-    // Create a dialog to display the memory maps
-    GtkWidget *dialog = gtk_dialog_new_with_buttons(
-        "Memory Maps",
-        NULL, // parent window
-        GTK_DIALOG_MODAL,
-        "_Close", GTK_RESPONSE_CLOSE,
-        NULL
-    );
 
-     gtk_window_set_default_size(GTK_WINDOW(dialog), 600, 400);
 
-    // Create a scrolled window with a text view
-    GtkWidget *scrolled_window = gtk_scrolled_window_new(NULL, NULL);
-    GtkWidget *text_view = gtk_text_view_new();
-    gtk_text_view_set_editable(GTK_TEXT_VIEW(text_view), FALSE);
-    gtk_text_view_set_wrap_mode(GTK_TEXT_VIEW(text_view), GTK_WRAP_WORD);
-    gtk_container_add(GTK_CONTAINER(scrolled_window), text_view);
 
-    // Add the scrolled window to the dialog
-    gtk_box_pack_start(GTK_BOX(gtk_dialog_get_content_area(GTK_DIALOG(dialog))),
-                       scrolled_window, TRUE, TRUE, 0);
+// Columns of the short-lived process log
+enum {
+    SHORT_LIVED_EXITED,
+    SHORT_LIVED_PID,
+    SHORT_LIVED_PPID,
+    SHORT_LIVED_NAME,
+    SHORT_LIVED_LIFETIME,
+    SHORT_LIVED_STATUS,
+    N_SHORT_LIVED_COLUMNS
+};
+
+// Show the processes the event tracker saw exit soon after they started,
+// newest first
+static void show_short_lived_cb(GtkButton *button, gpointer user_data) {
+    ShortLivedProcess *entries = g_new(ShortLivedProcess, PROC_EVENTS_LOG_SIZE);
+    guint n = proc_events_get_short_lived(entries, PROC_EVENTS_LOG_SIZE);
+    GtkListStore *store = gtk_list_store_new(N_SHORT_LIVED_COLUMNS, G_TYPE_STRING, G_TYPE_INT, G_TYPE_INT,
+                                             G_TYPE_STRING, G_TYPE_INT, G_TYPE_STRING);
+
+    for (guint i = 0; i < n; i++) {
+        const ShortLivedProcess *entry = &entries[i];
+        GDateTime *exited = g_date_time_new_from_unix_local(entry->exited / G_USEC_PER_SEC);
+        gchar *exited_text = g_date_time_format(exited, "%H:%M:%S");
+        gchar status[32];
+
+        if (WIFSIGNALED(entry->exit_code)) {
+            g_snprintf(status, sizeof(status), "signal %d", WTERMSIG(entry->exit_code));
+        } else {
+            g_snprintf(status, sizeof(status), "exit %d", WEXITSTATUS(entry->exit_code));
+        }
+        gtk_list_store_insert_with_values(store, NULL, -1,
+                                          SHORT_LIVED_EXITED, exited_text,
+                                          SHORT_LIVED_PID, entry->pid,
+                                          SHORT_LIVED_PPID, entry->ppid,
+                                          SHORT_LIVED_NAME, entry->comm,
+                                          SHORT_LIVED_LIFETIME, (gint)((entry->exited - entry->started) / 1000),
+                                          SHORT_LIVED_STATUS, status,
+                                          -1);
+        g_free(exited_text);
+        g_date_time_unref(exited);
+    }
+    g_free(entries);
+
+    GtkWidget *dialog = gtk_dialog_new_with_buttons("Short-lived Processes", NULL, 0, "_Close", GTK_RESPONSE_CLOSE, NULL);
+    gtk_window_set_default_size(GTK_WINDOW(dialog), 600, 400);
 
-    // Set the text buffer of the text view to the contents of the memory maps
-    GtkTextBuffer *buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(text_view));
-    gtk_text_buffer_set_text(buffer, contents, -1);
+    GtkWidget *tree_view = gtk_tree_view_new_with_model(GTK_TREE_MODEL(store));
+    g_object_unref(store); // Held by the tree view
+    const gchar *titles[N_SHORT_LIVED_COLUMNS] = { "Exited", "PID", "Parent PID", "Name", "Lifetime (ms)", "Status" };
+    for (gint i = 0; i < N_SHORT_LIVED_COLUMNS; i++) {
+        GtkTreeViewColumn *column = gtk_tree_view_column_new_with_attributes(
+            titles[i], gtk_cell_renderer_text_new(), "text", i, NULL);
+        gtk_tree_view_column_set_sort_column_id(column, i);
+        gtk_tree_view_append_column(GTK_TREE_VIEW(tree_view), column);
+    }
 
-    // Show all widgets in the dialog
+    GtkWidget *scrolled_window = gtk_scrolled_window_new(NULL, NULL);
+    gtk_container_add(GTK_CONTAINER(scrolled_window), tree_view);
+    gtk_box_pack_start(GTK_BOX(gtk_dialog_get_content_area(GTK_DIALOG(dialog))), scrolled_window, TRUE, TRUE, 0);
+    g_signal_connect(dialog, "response", G_CALLBACK(gtk_widget_destroy), NULL);
     gtk_widget_show_all(dialog);
+}
 
-    // Run the dialog and wait for the user to respond
-    gtk_dialog_run(GTK_DIALOG(dialog));
+// Process behind an iter of the sorted, filtered model shown by the view
+static gboolean get_view_target(ProcessView *view, GtkTreeModel *sort_model, GtkTreeIter *sort_iter,
+                                ProcessTarget *target) {
+    GtkTreeIter filter_iter, iter;
+    guint row;
 
-    // Clean up
+    gtk_tree_model_sort_convert_iter_to_child_iter(GTK_TREE_MODEL_SORT(sort_model), &filter_iter, sort_iter);
+    gtk_tree_model_filter_convert_iter_to_child_iter(view->filter_model, &iter, &filter_iter);
+    const ProcessColumns *columns = process_model_get_row(view->model, &iter, &row);
+    if (columns == NULL) {
+        return FALSE;
+    }
+    target->pid = (pid_t)columns->pid[row];
+    target->starttime = columns->starttime[row];
+    return TRUE;
+}
+
+// Signal targets and report the outcome of the whole batch in one dialog
+static void signal_targets(const GArray *targets, int signal) {
+    SignalSummary summary;
+    GString *errors = g_string_new(NULL);
+
+    process_signal_batch(targets, signal, &summary, errors);
+
+    GtkWidget *dialog = gtk_message_dialog_new(NULL, GTK_DIALOG_MODAL,
+                                               summary.sent == targets->len ? GTK_MESSAGE_INFO : GTK_MESSAGE_WARNING,
+                                               GTK_BUTTONS_CLOSE, "Sent %s (%d) to %u of %u processes",
+                                               g_strsignal(signal), signal, summary.sent, targets->len);
+    if (summary.sent < targets->len) {
+        gchar *counts = g_strdup_printf("%u had already exited, %u not permitted, %u failed",
+                                        summary.exited, summary.denied, summary.failed);
+        if (errors->len > 0) {
+            gtk_message_dialog_format_secondary_text(GTK_MESSAGE_DIALOG(dialog), "%s\n\n%s", counts, errors->str);
+        } else {
+            gtk_message_dialog_format_secondary_text(GTK_MESSAGE_DIALOG(dialog), "%s", counts);
+        }
+        g_free(counts);
+    }
+    gtk_dialog_run(GTK_DIALOG(dialog));
     gtk_widget_destroy(dialog);
-    g_free(contents);
+    g_string_free(errors, TRUE);
+
+    // Show the new states without waiting for the next scan
+    sampler_request_processes();
 }
 
+static void signal_selected(ProcessView *view, int signal) {
+    GtkTreeSelection *selection = gtk_tree_view_get_selection(GTK_TREE_VIEW(view->tree_view));
+    GtkTreeModel *sort_model;
+    GList *rows = gtk_tree_selection_get_selected_rows(selection, &sort_model);
+    GArray *targets = g_array_sized_new(FALSE, FALSE, sizeof(ProcessTarget), g_list_length(rows));
+
+    for (GList *l = rows; l != NULL; l = l->next) {
+        GtkTreeIter iter;
+        ProcessTarget target;
+        if (gtk_tree_model_get_iter(sort_model, &iter, l->data) &&
+            get_view_target(view, sort_model, &iter, &target)) {
+            g_array_append_val(targets, target);
+        }
+    }
+    g_list_free_full(rows, (GDestroyNotify)gtk_tree_path_free);
+
+    if (targets->len > 0) {
+        signal_targets(targets, signal);
+    }
+    g_array_unref(targets);
+}
 
+// Stop, Continue and Kill carry their signal as "signal" data
+static void signal_button_clicked_cb(GtkButton *button, gpointer user_data) {
+    signal_selected(user_data, GPOINTER_TO_INT(g_object_get_data(G_OBJECT(button), "signal")));
+}
 
+static void send_signal_clicked_cb(GtkButton *button, gpointer user_data) {
+    ProcessView *view = user_data;
+    signal_selected(view, gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(view->signal_spin)));
+}
 
+static void selection_changed_cb(GtkTreeSelection *selection, gpointer user_data) {
+    ProcessView *view = user_data;
+    gtk_widget_set_sensitive(view->actions, gtk_tree_selection_count_selected_rows(selection) > 0);
+}
+
+static GtkWidget *add_signal_button(ProcessView *view, GtkWidget *box, const gchar *label, int signal) {
+    GtkWidget *button = gtk_button_new_with_mnemonic(label);
+    g_object_set_data(G_OBJECT(button), "signal", GINT_TO_POINTER(signal));
+    g_signal_connect(button, "clicked", G_CALLBACK(signal_button_clicked_cb), view);
+    gtk_box_pack_start(GTK_BOX(box), button, FALSE, FALSE, 0);
+    return button;
+}
 
 void on_row_activated(GtkTreeView *tree_view, GtkTreePath *path, GtkTreeViewColumn *col, gpointer userdata) {
+    ProcessView *view = g_object_get_data(G_OBJECT(tree_view), "process-view");
     GtkTreeModel *model = gtk_tree_view_get_model(tree_view);
     GtkTreeIter iter;
+    ProcessTarget target;
 
-    if (gtk_tree_model_get_iter(model, &iter, path)) {
-        // Get the PID from the model
-        gint pid;
-        gtk_tree_model_get(model, &iter, COLUMN_PID, &pid, -1);
-
-        show_process_details(model, &iter);
+    if (gtk_tree_model_get_iter(model, &iter, path) && get_view_target(view, model, &iter, &target)) {
+        pid_t pid = target.pid;
+        GArray *targets = g_array_new(FALSE, FALSE, sizeof(ProcessTarget));
+        g_array_append_val(targets, target);
 
-        
+        show_process_details(pid);
 
         // Create a dialog with buttons for different actions
         GtkWidget *dialog = gtk_dialog_new_with_buttons(
@@ -566,34 +1084,29 @@ void on_row_activated(GtkTreeView *tree_view, GtkTreePath *path, GtkTreeViewColu
 
         // Run the dialog and wait for the user to respond
         gint result = gtk_dialog_run(GTK_DIALOG(dialog));
+        gtk_widget_destroy(dialog);
 
         // Handle the response
         switch (result) {
             case RESPONSE_STOP:
-                stop_process(pid);
+                signal_targets(targets, SIGSTOP);
                 break;
             case RESPONSE_CONTINUE:
-                continue_process(pid);
+                signal_targets(targets, SIGCONT);
                 break;
             case RESPONSE_KILL:
-                kill_process(pid);
+                signal_targets(targets, SIGKILL);
                 break;
             case RESPONSE_LIST_MEMORY_MAPS:
-                list_memory_maps(pid); // Implement this function
+                list_memory_maps(pid);
                 break;
             case RESPONSE_LIST_OPEN_FILES:
-                list_open_files(pid); // Implement this function
-                break;
-            case GTK_RESPONSE_CLOSE:
-                // Close the dialog
+                list_open_files(pid);
                 break;
             default:
-                // Handle unexpected response
                 break;
         }
-
-        // Destroy the dialog once finished
-        gtk_widget_destroy(dialog);
+        g_array_unref(targets);
     }
 }
 
@@ -613,84 +1126,367 @@ void populate_list_store(GtkListStore *store, GList *process_list) {
     }
 }
 
-// Function to filter processes based on search query
+// Function to filter processes based on search query and owner. Reads the
+// snapshot columns behind the row directly instead of copying cells out.
 static gboolean process_filter_func(GtkTreeModel *model, GtkTreeIter *iter, gpointer data) {
-    const gchar *search_query = data;
-    gchar *name;
-    gboolean visible = FALSE;
+    ProcessFilter *filter = data;
+    guint row;
+    const ProcessColumns *columns = process_model_get_row(PROCESS_MODEL(model), iter, &row);
 
-    if (!search_query || !*search_query) {
-        return TRUE; // Show all rows if no search query
+    if (filter->marks != NULL) {
+        return columns == filter->columns && filter->marks[row];
     }
+    return filter_row_matches(columns, row, filter);
+}
+
+// Compile the search text and refilter once typing has paused
+static gboolean apply_search(gpointer user_data) {
+    ProcessView *view = user_data;
+    const gchar *text = gtk_entry_get_text(GTK_ENTRY(view->search_entry));
+    GError *error = NULL;
 
-    gtk_tree_model_get(model, iter, COLUMN_NAME, &name, -1);
+    view->search_source = 0;
 
-    if (name != NULL) {
-        visible = g_strstr_len(name, -1, search_query) != NULL;
-        g_free(name);
+    gchar *normalized = g_strstrip(g_strdup(text));
+    const gchar *current = view->filter.query != NULL ? process_query_get_text(view->filter.query) : "";
+    if (strcmp(normalized, current) == 0) {
+        g_free(normalized);
+        return G_SOURCE_REMOVE;
     }
 
-    return visible;
+    ProcessQuery *query = *normalized != '\0' ? process_query_new(normalized, &error) : NULL;
+    g_free(normalized);
+
+    // Keep showing every row while the text does not parse, and say why
+    gtk_entry_set_icon_from_icon_name(GTK_ENTRY(view->search_entry), GTK_ENTRY_ICON_SECONDARY,
+                                      error != NULL ? "dialog-warning" : NULL);
+    gtk_entry_set_icon_tooltip_text(GTK_ENTRY(view->search_entry), GTK_ENTRY_ICON_SECONDARY,
+                                    error != NULL ? error->message : NULL);
+    g_clear_error(&error);
+
+    process_query_free(view->filter.query);
+    view->filter.query = query;
+    refilter_view(view);
+    return G_SOURCE_REMOVE;
 }
 
-// Callback for search entry changes
-void search_entry_changed_cb(GtkSearchEntry *search_entry, gpointer user_data) {
-    const gchar *text = gtk_entry_get_text(GTK_ENTRY(search_entry));
-    gtk_tree_model_filter_set_visible_func(GTK_TREE_MODEL_FILTER(user_data), process_filter_func, (gpointer)text, NULL);
-    gtk_tree_model_filter_refilter(GTK_TREE_MODEL_FILTER(user_data));
+// Callback for search entry changes: restart the debounce timer
+void search_entry_changed_cb(GtkEditable *editable, gpointer user_data) {
+    ProcessView *view = user_data;
+
+    if (view->search_source != 0) {
+        g_source_remove(view->search_source);
+    }
+    view->search_source = g_timeout_add(SEARCH_DEBOUNCE_MS, apply_search, view);
+}
+
+// Enter applies the search right away
+static void search_entry_activate_cb(GtkEntry *entry, gpointer user_data) {
+    ProcessView *view = user_data;
+
+    if (view->search_source != 0) {
+        g_source_remove(view->search_source);
+        apply_search(view);
+    }
+}
+
+static void only_user_toggled_cb(GtkToggleButton *button, gpointer user_data) {
+    ProcessView *view = user_data;
+
+    only_user_processes = gtk_toggle_button_get_active(button);
+    view->filter.user = only_user_processes ? user_cache_lookup(getuid()) : NULL;
+    refilter_view(view);
+}
+
+// Sort on the raw column values of the process model rather than the generic
+// GValue comparison, which would copy every name and user string compared
+static gint process_sort_func(GtkTreeModel *model, GtkTreeIter *a, GtkTreeIter *b, gpointer user_data) {
+    GtkTreeModelFilter *filter_model = GTK_TREE_MODEL_FILTER(model);
+    GtkTreeIter child_a, child_b;
+
+    gtk_tree_model_filter_convert_iter_to_child_iter(filter_model, &child_a, a);
+    gtk_tree_model_filter_convert_iter_to_child_iter(filter_model, &child_b, b);
+    return process_model_compare(PROCESS_MODEL(gtk_tree_model_filter_get_model(filter_model)),
+                                 &child_a, &child_b, GPOINTER_TO_INT(user_data));
+}
+
+// Put a fresh model stack (process model -> filter -> sort) behind the view,
+// flat or nested by parent PID, and fill it from the last scan
+static void set_process_model(ProcessView *view) {
+    ProcessModel *model = process_model_new(tree_mode);
+    view->filter.tree = tree_mode;
+    view->filter.columns = NULL;
+    g_clear_pointer(&view->filter.marks, g_free);
+    GtkTreeModelFilter *filter_model = GTK_TREE_MODEL_FILTER(gtk_tree_model_filter_new(GTK_TREE_MODEL(model), NULL));
+    gtk_tree_model_filter_set_visible_func(filter_model, process_filter_func, &view->filter, NULL);
+    GtkTreeModel *sort_model = gtk_tree_model_sort_new_with_model(GTK_TREE_MODEL(filter_model));
+    for (gint column = 0; column < N_PROCESS_COLUMNS; column++) {
+        gtk_tree_sortable_set_sort_func(GTK_TREE_SORTABLE(sort_model), column, process_sort_func,
+                                        GINT_TO_POINTER(column), NULL);
+    }
+
+    // Keep the sort order the user picked on the previous model
+    GtkTreeModel *old_sort_model = gtk_tree_view_get_model(GTK_TREE_VIEW(view->tree_view));
+    gint sort_column;
+    GtkSortType sort_order;
+    if (old_sort_model != NULL &&
+        gtk_tree_sortable_get_sort_column_id(GTK_TREE_SORTABLE(old_sort_model), &sort_column, &sort_order)) {
+        gtk_tree_sortable_set_sort_column_id(GTK_TREE_SORTABLE(sort_model), sort_column, sort_order);
+    }
+
+    gtk_tree_view_set_model(GTK_TREE_VIEW(view->tree_view), sort_model);
+    g_object_unref(model); // Release the process model as the filter model holds a reference to it
+    g_object_unref(filter_model); // Likewise held by the sort model
+    g_object_unref(sort_model); // Held by the tree view
+    view->model = model;
+    view->filter_model = filter_model;
+
+    gtk_tree_view_column_set_visible(view->tree_cpu_column, tree_mode);
+    gtk_tree_view_column_set_visible(view->tree_memory_column, tree_mode);
+
+    const Snapshot *latest = sampler_get_latest(SNAPSHOT_PROCESSES);
+    if (latest != NULL) {
+        apply_process_snapshot(view, latest);
+    }
+    if (tree_mode) {
+        gtk_tree_view_expand_all(GTK_TREE_VIEW(view->tree_view));
+    }
+}
+
+static void tree_mode_toggled_cb(GtkToggleButton *button, gpointer user_data) {
+    tree_mode = gtk_toggle_button_get_active(button);
+    set_process_model(user_data);
+}
+
+// Automatic refreshes only run while the list is on screen
+static guint process_subscription = 0;
+
+static void subscribe_processes(void) {
+    if (process_subscription == 0) {
+        process_subscription = sampler_subscribe(SAMPLER_PROCESSES, refresh_interval_ms);
+    }
+}
+
+static void unsubscribe_processes(void) {
+    if (process_subscription != 0) {
+        sampler_unsubscribe(process_subscription);
+        process_subscription = 0;
+    }
+}
+
+static void on_process_view_map(GtkWidget *widget, gpointer user_data) {
+    ProcessView *view = user_data;
+    const Snapshot *latest = sampler_get_latest(SNAPSHOT_PROCESSES);
+
+    if (view->stale && latest != NULL) {
+        apply_process_snapshot(view, latest);
+    }
+    view->stale = FALSE;
+    subscribe_processes();
+}
+
+static void on_process_view_unmap(GtkWidget *widget, gpointer user_data) {
+    unsubscribe_processes();
+}
+
+static void refresh_interval_changed_cb(GtkSpinButton *spin_button, gpointer user_data) {
+    refresh_interval_ms = (guint)(gtk_spin_button_get_value(spin_button) * 1000);
+    if (process_subscription != 0) {
+        unsubscribe_processes();
+        subscribe_processes();
+    }
 }
 
 // Function to create and display the tree view for process information
-void display_process_info(GtkWidget *box, gboolean only_user_processes) {
-    GtkListStore *store = gtk_list_store_new(5, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_INT, G_TYPE_FLOAT, G_TYPE_STRING);
-    GtkTreeModelFilter *filter_model = GTK_TREE_MODEL_FILTER(gtk_tree_model_filter_new(GTK_TREE_MODEL(store), NULL));
+void display_process_info(GtkWidget *box) {
+    ProcessView *view = g_new0(ProcessView, 1);
+    view->filter.user = only_user_processes ? user_cache_lookup(getuid()) : NULL;
 
-    // Set up the search entry
+    // Set up the search entry; refiltering is debounced here rather than by
+    // GtkSearchEntry so that Enter can skip the delay
     GtkWidget *search_entry = gtk_search_entry_new();
-    g_signal_connect(search_entry, "search-changed", G_CALLBACK(search_entry_changed_cb), filter_model);
+    gtk_entry_set_placeholder_text(GTK_ENTRY(search_entry), "Search, e.g. user:postgres state:D mem>500 cpu>20 cmd~regex");
+    view->search_entry = search_entry;
+    g_signal_connect(search_entry, "changed", G_CALLBACK(search_entry_changed_cb), view);
+    g_signal_connect(search_entry, "activate", G_CALLBACK(search_entry_activate_cb), view);
     gtk_box_pack_start(GTK_BOX(box), search_entry, FALSE, FALSE, 0);
 
-    // Create the tree view with the filter model
-    GtkWidget *tree_view = gtk_tree_view_new_with_model(GTK_TREE_MODEL(filter_model));
-    g_object_unref(store); // Release the list store as the filter model holds a reference to it
+    // Create the tree view; set_process_model() puts the sorted, filtered model behind it
+    GtkWidget *tree_view = gtk_tree_view_new();
+    view->tree_view = tree_view;
+    g_object_set_data_full(G_OBJECT(tree_view), "process-view", view, process_view_free);
 
     // Add columns to the tree view
-    add_tree_view_column(tree_view, "Process Name", COLUMN_NAME);
-    add_tree_view_column(tree_view, "Status", COLUMN_STATUS);
-    add_tree_view_column(tree_view, "PID", COLUMN_PID);
-    add_tree_view_column(tree_view, "Memory (MiB)", COLUMN_MEMORY);
-    add_tree_view_column(tree_view, "User", COLUMN_USER);
-
-    // Populate the list store
-    get_process_info(store, only_user_processes);
+    add_tree_view_column(tree_view, "Process Name", COLUMN_NAME, text_cell_data_func, 0.0);
+    add_tree_view_column(tree_view, "Status", COLUMN_STATUS, text_cell_data_func, 0.0);
+    add_tree_view_column(tree_view, "PID", COLUMN_PID, int_cell_data_func, 1.0);
+    add_tree_view_column(tree_view, "Memory (MiB)", COLUMN_MEMORY, float_cell_data_func, 1.0);
+    add_tree_view_column(tree_view, "User", COLUMN_USER, text_cell_data_func, 0.0);
+    add_tree_view_column(tree_view, "CPU %", COLUMN_CPU, float_cell_data_func, 1.0);
+    view->tree_cpu_column = add_tree_view_column(tree_view, "Tree CPU %", COLUMN_TREE_CPU,
+                                                 float_cell_data_func, 1.0);
+    view->tree_memory_column = add_tree_view_column(tree_view, "Tree Memory (MiB)", COLUMN_TREE_MEMORY,
+                                                    float_cell_data_func, 1.0);
+    add_tree_view_column(tree_view, "Disk Read", COLUMN_READ_RATE, byte_rate_cell_data_func, 1.0);
+    add_tree_view_column(tree_view, "Disk Write", COLUMN_WRITE_RATE, byte_rate_cell_data_func, 1.0);
+    add_tree_view_column(tree_view, "I/O Calls/s", COLUMN_SYSCALL_RATE, call_rate_cell_data_func, 1.0);
+
+    // Label reporting how many rows each refresh touched
+    GtkWidget *status_label = gtk_label_new(NULL);
+    gtk_label_set_xalign(GTK_LABEL(status_label), 0.0);
+    view->status_label = status_label;
+
+    // Populate the model from the last scan, then ask the sampler for a fresh one
+    set_process_model(view);
+    view->listener_id = sampler_add_listener(on_process_snapshot, view);
+    g_signal_connect(tree_view, "destroy", G_CALLBACK(on_process_view_destroy), view);
+    g_signal_connect(tree_view, "map", G_CALLBACK(on_process_view_map), view);
+    g_signal_connect(tree_view, "unmap", G_CALLBACK(on_process_view_unmap), NULL);
+    sampler_request_processes();
 
     // Scrolled window for the tree view
     GtkWidget *scrolled_window = gtk_scrolled_window_new(NULL, NULL);
     gtk_container_add(GTK_CONTAINER(scrolled_window), tree_view);
     gtk_box_pack_start(GTK_BOX(box), scrolled_window, TRUE, TRUE, 0);
+    gtk_box_pack_start(GTK_BOX(box), status_label, FALSE, FALSE, 0);
 
     // Row activated signal
     g_signal_connect(tree_view, "row-activated", G_CALLBACK(on_row_activated), NULL);
 
-    // Refresh button
+    // Signals for every selected process at once
+    GtkTreeSelection *selection = gtk_tree_view_get_selection(GTK_TREE_VIEW(tree_view));
+    gtk_tree_selection_set_mode(selection, GTK_SELECTION_MULTIPLE);
+    g_signal_connect(selection, "changed", G_CALLBACK(selection_changed_cb), view);
+
+    GtkWidget *actions = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 6);
+    view->actions = actions;
+    gtk_box_pack_start(GTK_BOX(actions), gtk_label_new("Selected:"), FALSE, FALSE, 0);
+    add_signal_button(view, actions, "_Stop", SIGSTOP);
+    add_signal_button(view, actions, "_Continue", SIGCONT);
+    add_signal_button(view, actions, "_Kill", SIGKILL);
+    view->signal_spin = gtk_spin_button_new_with_range(1, SIGRTMAX, 1);
+    gtk_spin_button_set_value(GTK_SPIN_BUTTON(view->signal_spin), SIGTERM);
+    GtkWidget *send_button = gtk_button_new_with_label("Send Signal");
+    g_signal_connect(send_button, "clicked", G_CALLBACK(send_signal_clicked_cb), view);
+    gtk_box_pack_start(GTK_BOX(actions), send_button, FALSE, FALSE, 0);
+    gtk_box_pack_start(GTK_BOX(actions), view->signal_spin, FALSE, FALSE, 0);
+    gtk_widget_set_sensitive(actions, FALSE);
+    gtk_box_pack_start(GTK_BOX(box), actions, FALSE, FALSE, 0);
+
+    // View mode, owner filter, refresh interval and manual refresh
+    GtkWidget *controls = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 6);
+
+    GtkWidget *tree_button = gtk_check_button_new_with_label("Tree view");
+    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(tree_button), tree_mode);
+    g_signal_connect(tree_button, "toggled", G_CALLBACK(tree_mode_toggled_cb), view);
+    gtk_box_pack_start(GTK_BOX(controls), tree_button, FALSE, FALSE, 0);
+
+    GtkWidget *only_user_button = gtk_check_button_new_with_label("Only my processes");
+    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(only_user_button), only_user_processes);
+    g_signal_connect(only_user_button, "toggled", G_CALLBACK(only_user_toggled_cb), view);
+    gtk_box_pack_start(GTK_BOX(controls), only_user_button, FALSE, FALSE, 0);
+
+    // Only available while process events are received (needs CAP_NET_ADMIN)
+    GtkWidget *short_lived_button = gtk_button_new_with_label("Short-lived...");
+    gtk_widget_set_sensitive(short_lived_button, proc_events_active());
+    gtk_widget_set_tooltip_text(short_lived_button, proc_events_active()
+                                ? "Processes that exited within seconds of starting"
+                                : "Needs the kernel process connector (CAP_NET_ADMIN)");
+    g_signal_connect(short_lived_button, "clicked", G_CALLBACK(show_short_lived_cb), NULL);
+    gtk_box_pack_start(GTK_BOX(controls), short_lived_button, FALSE, FALSE, 0);
+
+    GtkWidget *interval_spin = gtk_spin_button_new_with_range(1, 60, 1);
+    gtk_spin_button_set_value(GTK_SPIN_BUTTON(interval_spin), refresh_interval_ms / 1000.0);
+    g_signal_connect(interval_spin, "value-changed", G_CALLBACK(refresh_interval_changed_cb), tree_view);
+    gtk_box_pack_end(GTK_BOX(controls), gtk_label_new("s"), FALSE, FALSE, 0);
+    gtk_box_pack_end(GTK_BOX(controls), interval_spin, FALSE, FALSE, 0);
+    gtk_box_pack_end(GTK_BOX(controls), gtk_label_new("Update every"), FALSE, FALSE, 0);
+
     GtkWidget *refresh_button = gtk_button_new_with_label("Refresh");
-    g_signal_connect(refresh_button, "clicked", G_CALLBACK(refresh_process_list), store);
-    gtk_box_pack_start(GTK_BOX(box), refresh_button, FALSE, FALSE, 0);
+    g_signal_connect(refresh_button, "clicked", G_CALLBACK(refresh_process_list), NULL);
+    gtk_box_pack_end(GTK_BOX(controls), refresh_button, FALSE, FALSE, 0);
+
+    gtk_box_pack_start(GTK_BOX(box), controls, FALSE, FALSE, 0);
 
     gtk_widget_show_all(box);
 }
 
 
-// Add a column to the tree view
-void add_tree_view_column(GtkWidget *tree_view, const gchar *title, gint column_id) {
+// Cell data functions format the raw model values of visible rows only;
+// sorting never goes through them (see process_sort_func())
+
+// The model hands out its strings as static, so reading them copies nothing
+static void text_cell_data_func(GtkTreeViewColumn *column, GtkCellRenderer *renderer,
+                                GtkTreeModel *model, GtkTreeIter *iter, gpointer user_data) {
+    GValue value = G_VALUE_INIT;
+    gtk_tree_model_get_value(model, iter, GPOINTER_TO_INT(user_data), &value);
+    g_object_set(renderer, "text", g_value_get_string(&value), NULL);
+    g_value_unset(&value);
+}
+
+static void int_cell_data_func(GtkTreeViewColumn *column, GtkCellRenderer *renderer,
+                               GtkTreeModel *model, GtkTreeIter *iter, gpointer user_data) {
+    gint value;
+    gchar text[16];
+    gtk_tree_model_get(model, iter, GPOINTER_TO_INT(user_data), &value, -1);
+    g_snprintf(text, sizeof(text), "%d", value);
+    g_object_set(renderer, "text", text, NULL);
+}
+
+// Show a float column with one decimal instead of the raw float
+static void float_cell_data_func(GtkTreeViewColumn *column, GtkCellRenderer *renderer,
+                                 GtkTreeModel *model, GtkTreeIter *iter, gpointer user_data) {
+    gfloat value;
+    gchar text[16];
+    gtk_tree_model_get(model, iter, GPOINTER_TO_INT(user_data), &value, -1);
+    g_snprintf(text, sizeof(text), "%.1f", value);
+    g_object_set(renderer, "text", text, NULL);
+}
+
+// Rates are -1 for processes whose io is not readable; those cells stay blank
+static void byte_rate_cell_data_func(GtkTreeViewColumn *column, GtkCellRenderer *renderer,
+                                     GtkTreeModel *model, GtkTreeIter *iter, gpointer user_data) {
+    gfloat value;
+    gtk_tree_model_get(model, iter, GPOINTER_TO_INT(user_data), &value, -1);
+    if (value < 0.0f) {
+        g_object_set(renderer, "text", "", NULL);
+        return;
+    }
+    gchar *size = g_format_size((guint64)value);
+    gchar *text = g_strconcat(size, "/s", NULL);
+    g_object_set(renderer, "text", text, NULL);
+    g_free(text);
+    g_free(size);
+}
+
+static void call_rate_cell_data_func(GtkTreeViewColumn *column, GtkCellRenderer *renderer,
+                                     GtkTreeModel *model, GtkTreeIter *iter, gpointer user_data) {
+    gfloat value;
+    gchar text[16] = "";
+    gtk_tree_model_get(model, iter, GPOINTER_TO_INT(user_data), &value, -1);
+    if (value >= 0.0f) {
+        g_snprintf(text, sizeof(text), "%.0f", value);
+    }
+    g_object_set(renderer, "text", text, NULL);
+}
+
+// Add a column drawn by cell_func; click the header to sort by it
+static GtkTreeViewColumn *add_tree_view_column(GtkWidget *tree_view, const gchar *title, gint column_id,
+                                               GtkTreeCellDataFunc cell_func, gfloat xalign) {
     GtkCellRenderer *renderer = gtk_cell_renderer_text_new();
-    GtkTreeViewColumn *column = gtk_tree_view_column_new_with_attributes(title, renderer, "text", column_id, NULL);
+    g_object_set(renderer, "xalign", xalign, NULL);
+    GtkTreeViewColumn *column = gtk_tree_view_column_new();
+    gtk_tree_view_column_set_title(column, title);
+    gtk_tree_view_column_pack_start(column, renderer, TRUE);
+    gtk_tree_view_column_set_cell_data_func(column, renderer, cell_func, GINT_TO_POINTER(column_id), NULL);
+    gtk_tree_view_column_set_sort_column_id(column, column_id);
     gtk_tree_view_append_column(GTK_TREE_VIEW(tree_view), column);
+    return column;
 }
 
 void refresh_process_list(GtkButton *button, gpointer user_data) {
-    GtkListStore *store = GTK_LIST_STORE(user_data);
-    get_process_info(store, TRUE);
+    // The scan runs on the sampler thread; the listener applies the result
+    sampler_request_processes();
 }
 
 // Free the process list and its contents
@@ -0,0 +1,338 @@
+/*
+ * procfs.c
+ * Allocation-free readers for per-process files under /proc. Files are read
+ * with a single read() into a caller-sized stack buffer and tokenized in one
+ * pass, so a refresh of thousands of PIDs costs no mallocs. System-wide files
+ * read on every tick stay open instead, see procfs_file_read().
+ */
+
+#define _GNU_SOURCE
+#include <glib.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "procfs.h"
+
+#define STAT_BUFFER_SIZE 1024
+#define STATM_BUFFER_SIZE 128
+#define STATUS_BUFFER_SIZE 4096
+#define IO_BUFFER_SIZE 512
+
+#define KTHREADD_PID 2   // parent of every kernel thread
+
+// Read a whole (small) proc file relative to proc_fd, NUL-terminated.
+// Returns the number of bytes read, or -1. If st is given, the file's
+// owner and mode are filled in from the open descriptor.
+static gssize read_proc_file(int proc_fd, const char *path, char *buf, gsize size, struct stat *st) {
+    int fd = openat(proc_fd, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    if (st != NULL && fstat(fd, st) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    gssize len = read(fd, buf, size - 1);
+    close(fd);
+    if (len < 0) {
+        return -1;
+    }
+    buf[len] = '\0';
+    return len;
+}
+
+static const char *parse_i64(const char *p, const char *end, gint64 *out) {
+    gboolean negative = FALSE;
+    guint64 value;
+
+    p = procfs_skip_spaces(p, end);
+    if (p < end && *p == '-') {
+        negative = TRUE;
+        p++;
+    }
+    p = procfs_parse_u64(p, end, &value);
+    *out = negative ? -(gint64)value : (gint64)value;
+    return p;
+}
+
+// Parse one /proc/[pid]/stat line. The command name is delimited by the first
+// '(' and the *last* ')', since the name itself may contain spaces and parens.
+gboolean procfs_parse_stat(const char *buf, gsize len, ProcStat *out) {
+    const char *end = buf + len;
+    const char *open = memchr(buf, '(', len);
+    const char *close = memrchr(buf, ')', len);
+    guint64 value;
+    gint64 signed_value;
+
+    if (open == NULL || close == NULL || close < open) {
+        return FALSE;
+    }
+
+    procfs_parse_u64(buf, open, &value);
+    out->pid = (pid_t)value;
+
+    gsize comm_len = MIN((gsize)(close - open - 1), sizeof(out->comm) - 1);
+    memcpy(out->comm, open + 1, comm_len);
+    out->comm[comm_len] = '\0';
+
+    // Field 3 onwards
+    const char *p = procfs_skip_spaces(close + 1, end);
+    if (p >= end) {
+        return FALSE;
+    }
+    out->state = *p++;
+
+    p = parse_i64(p, end, &signed_value);              // 4 ppid
+    out->ppid = (pid_t)signed_value;
+    p = procfs_skip_fields(p, end, 9);                 // 5..13 pgrp .. cmajflt
+    p = procfs_parse_u64(p, end, &out->utime);         // 14
+    p = procfs_parse_u64(p, end, &out->stime);         // 15
+    p = procfs_skip_fields(p, end, 4);                 // 16..19 cutime .. nice
+    p = parse_i64(p, end, &out->num_threads);          // 20
+    p = procfs_skip_fields(p, end, 1);                 // 21 itrealvalue
+    p = procfs_parse_u64(p, end, &out->starttime);     // 22
+    p = procfs_parse_u64(p, end, &out->vsize);         // 23
+    p = procfs_skip_fields(p, end, 15);                // 24..38 rss .. exit_signal
+    parse_i64(p, end, &out->processor);                // 39
+
+    return TRUE;
+}
+
+gboolean procfs_parse_statm(const char *buf, gsize len, ProcStat *out) {
+    const char *end = buf + len;
+    const char *p = procfs_parse_u64(buf, end, &out->size);
+    p = procfs_parse_u64(p, end, &out->resident);
+    procfs_parse_u64(p, end, &out->shared);
+    return p > buf;
+}
+
+// Value of a "Key:<whitespace>value" line in buf, or NULL. key includes the colon.
+static const char *find_key(const char *buf, const char *end, const char *key) {
+    gsize key_len = strlen(key);
+    const char *line = buf;
+
+    while (line < end) {
+        if ((gsize)(end - line) > key_len && memcmp(line, key, key_len) == 0) {
+            return line + key_len;
+        }
+        line = memchr(line, '\n', end - line);
+        if (line == NULL) {
+            break;
+        }
+        line++;
+    }
+    return NULL;
+}
+
+static guint64 key_u64(const char *buf, const char *end, const char *key) {
+    guint64 value = 0;
+    const char *p = find_key(buf, end, key);
+    if (p != NULL) {
+        while (p < end && (*p == ' ' || *p == '\t')) {
+            p++;
+        }
+        procfs_parse_u64(p, end, &value);
+    }
+    return value;
+}
+
+// Read /proc/[pid]/stat and statm relative to an open /proc directory.
+// Returns FALSE if the process went away or its files are unreadable.
+gboolean procfs_read_pid_stat(int proc_fd, pid_t pid, ProcStat *out) {
+    char path[32];
+    char buf[STAT_BUFFER_SIZE];
+    struct stat st;
+    gssize len;
+
+    g_snprintf(path, sizeof(path), "%d/stat", (int)pid);
+    len = read_proc_file(proc_fd, path, buf, sizeof(buf), &st);
+    if (len <= 0 || !procfs_parse_stat(buf, len, out)) {
+        return FALSE;
+    }
+    // /proc/[pid] belongs to the effective UID, and to root for every
+    // non-dumpable task (setuid programs, ssh-agent, sshd sessions). Only
+    // then is the world-readable status file needed for the real UID.
+    // Kernel threads are root either way.
+    out->uid = st.st_uid;
+    if (out->uid == 0 && out->pid != KTHREADD_PID && out->ppid != KTHREADD_PID) {
+        g_snprintf(path, sizeof(path), "%d/status", (int)pid);
+        len = read_proc_file(proc_fd, path, buf, sizeof(buf), NULL);
+        if (len > 0) {
+            out->uid = (uid_t)key_u64(buf, buf + len, "Uid:");
+        }
+    }
+
+    g_snprintf(path, sizeof(path), "%d/statm", (int)pid);
+    len = read_proc_file(proc_fd, path, buf, STATM_BUFFER_SIZE, NULL);
+    if (len <= 0 || !procfs_parse_statm(buf, len, out)) {
+        out->size = out->resident = out->shared = 0;
+    }
+
+    return TRUE;
+}
+
+// Fields of /proc/[pid]/status that stat does not carry. Kernel threads have
+// no Vm* lines; those stay 0.
+void procfs_parse_status(const char *buf, gsize len, ProcDetails *out) {
+    const char *end = buf + len;
+    out->real_uid = (uid_t)key_u64(buf, end, "Uid:");
+    out->vm_peak = key_u64(buf, end, "VmPeak:");
+    out->vm_hwm = key_u64(buf, end, "VmHWM:");
+    out->vm_swap = key_u64(buf, end, "VmSwap:");
+    out->voluntary_ctxt_switches = key_u64(buf, end, "voluntary_ctxt_switches:");
+    out->nonvoluntary_ctxt_switches = key_u64(buf, end, "nonvoluntary_ctxt_switches:");
+}
+
+gboolean procfs_parse_io(const char *buf, gsize len, ProcIo *out) {
+    const char *end = buf + len;
+    if (find_key(buf, end, "rchar:") == NULL) {
+        return FALSE;
+    }
+    out->rchar = key_u64(buf, end, "rchar:");
+    out->wchar = key_u64(buf, end, "wchar:");
+    out->syscr = key_u64(buf, end, "syscr:");
+    out->syscw = key_u64(buf, end, "syscw:");
+    out->read_bytes = key_u64(buf, end, "read_bytes:");
+    out->write_bytes = key_u64(buf, end, "write_bytes:");
+    return TRUE;
+}
+
+// stat, statm, status and io of pid, each read once. Returns FALSE if the
+// process is gone; an unreadable io file (another user's process) only
+// clears has_io.
+gboolean procfs_read_pid_details(int proc_fd, pid_t pid, ProcDetails *out) {
+    char path[32];
+    char buf[STATUS_BUFFER_SIZE];
+    gssize len;
+
+    memset(out, 0, sizeof(*out));
+    if (!procfs_read_pid_stat(proc_fd, pid, &out->stat)) {
+        return FALSE;
+    }
+
+    g_snprintf(path, sizeof(path), "%d/status", (int)pid);
+    len = read_proc_file(proc_fd, path, buf, sizeof(buf), NULL);
+    if (len > 0) {
+        procfs_parse_status(buf, len, out);
+    }
+
+    out->has_io = procfs_read_pid_io(proc_fd, pid, &out->io);
+    return TRUE;
+}
+
+// io of pid alone, for the scan. FALSE both when the process is gone and when
+// it belongs to another user (EACCES); neither is worth reporting per row.
+gboolean procfs_read_pid_io(int proc_fd, pid_t pid, ProcIo *out) {
+    char path[32];
+    char buf[IO_BUFFER_SIZE];
+    gssize len;
+
+    g_snprintf(path, sizeof(path), "%d/io", (int)pid);
+    len = read_proc_file(proc_fd, path, buf, sizeof(buf), NULL);
+    return len > 0 && procfs_parse_io(buf, len, out);
+}
+
+// stat and status of thread tid of pid, for the thread view. Only the
+// stat fields and the context switch counts are filled.
+gboolean procfs_read_task(int proc_fd, pid_t pid, pid_t tid, ProcDetails *out) {
+    char path[48];
+    char buf[STATUS_BUFFER_SIZE];
+    gssize len;
+
+    memset(out, 0, sizeof(*out));
+    g_snprintf(path, sizeof(path), "%d/task/%d/stat", (int)pid, (int)tid);
+    len = read_proc_file(proc_fd, path, buf, STAT_BUFFER_SIZE, NULL);
+    if (len <= 0 || !procfs_parse_stat(buf, len, &out->stat)) {
+        return FALSE;
+    }
+
+    g_snprintf(path, sizeof(path), "%d/task/%d/status", (int)pid, (int)tid);
+    len = read_proc_file(proc_fd, path, buf, sizeof(buf), NULL);
+    if (len > 0) {
+        procfs_parse_status(buf, len, out);
+    }
+    return TRUE;
+}
+
+#define PROCFS_FILE_MIN_SIZE 4096
+
+// Contents of file, NUL-terminated in file->buf; returns their length or -1.
+// Files in /proc are generated afresh on a read from offset 0, so once open
+// a pass costs a pread() per page or so of text, plus the one that finds the
+// end. The buffer grows to the largest size seen and is kept.
+gssize procfs_file_read(ProcfsFile *file) {
+    gsize len = 0;
+
+    if (file->fd < 0) {
+        file->fd = open(file->path, O_RDONLY | O_CLOEXEC);
+        if (file->fd < 0) {
+            return -1;
+        }
+    }
+    if (file->buf == NULL) {
+        file->size = PROCFS_FILE_MIN_SIZE;
+        file->buf = g_malloc(file->size);
+    }
+
+    for (;;) {
+        if (len == file->size - 1) {
+            file->size *= 2;
+            file->buf = g_realloc(file->buf, file->size);
+        }
+        gssize n = pread(file->fd, file->buf + len, file->size - 1 - len, len);
+        if (n < 0) {
+            // Reopened on the next pass, in case the file was replaced
+            procfs_file_close(file);
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        len += n;
+    }
+    file->buf[len] = '\0';
+    return len;
+}
+
+void procfs_file_close(ProcfsFile *file) {
+    if (file->fd >= 0) {
+        close(file->fd);
+        file->fd = -1;
+    }
+}
+
+// Boot time in seconds since the epoch (btime of /proc/stat); starttime
+// values are clock ticks after it. Read once, as it does not change.
+guint64 procfs_boot_time(void) {
+    static guint64 boot_time = 0;
+    gchar *contents = NULL;
+    gsize len;
+
+    // The per-CPU lines come first, so on big machines btime is well past
+    // any fixed buffer; this runs once, so read the whole file
+    if (boot_time == 0 && g_file_get_contents("/proc/stat", &contents, &len, NULL)) {
+        boot_time = key_u64(contents, contents + len, "btime");
+        g_free(contents);
+    }
+    return boot_time;
+}
+
+// Human-readable form of the one-letter state, matching the State: line of
+// /proc/[pid]/status
+const gchar *procfs_state_name(char state) {
+    switch (state) {
+        case 'R': return "R (running)";
+        case 'S': return "S (sleeping)";
+        case 'D': return "D (disk sleep)";
+        case 'T': return "T (stopped)";
+        case 't': return "t (tracing stop)";
+        case 'X': return "X (dead)";
+        case 'Z': return "Z (zombie)";
+        case 'P': return "P (parked)";
+        case 'I': return "I (idle)";
+        default:  return "? (unknown)";
+    }
+}
@@ -0,0 +1,116 @@
+// procfs.h
+#ifndef PROCFS_H
+#define PROCFS_H
+
+#include <glib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#define PROCFS_COMM_LEN 64
+
+// Fields of /proc/[pid]/stat and /proc/[pid]/statm that the task manager uses.
+// Filled in place by procfs_read_pid_stat() without touching the heap.
+typedef struct {
+    pid_t pid;
+    char comm[PROCFS_COMM_LEN];
+    char state;
+    pid_t ppid;
+    guint64 utime;          // clock ticks
+    guint64 stime;          // clock ticks
+    gint64 num_threads;
+    guint64 starttime;      // clock ticks after boot
+    guint64 vsize;          // bytes
+    gint64 processor;       // CPU last run on
+    uid_t uid;              // real UID, as the Uid: line of status
+    guint64 size;           // statm: total program size, pages
+    guint64 resident;       // statm: resident set, pages
+    guint64 shared;         // statm: shared pages
+} ProcStat;
+
+// Counters of /proc/[pid]/io, which is only readable by the owner or root
+typedef struct {
+    guint64 rchar;          // bytes
+    guint64 wchar;
+    guint64 syscr;          // read and write syscalls
+    guint64 syscw;
+    guint64 read_bytes;     // bytes that reached the block layer
+    guint64 write_bytes;
+} ProcIo;
+
+// Everything the details dialog shows about one PID: stat and statm plus the
+// parts of /proc/[pid]/status and /proc/[pid]/io the scan does not read.
+// Filled by procfs_read_pid_details() with one read of each file.
+typedef struct {
+    ProcStat stat;
+    uid_t real_uid;         // status: Uid (real)
+    guint64 vm_peak;        // status: kB
+    guint64 vm_hwm;         // status: peak resident set, kB
+    guint64 vm_swap;        // status: kB
+    guint64 voluntary_ctxt_switches;
+    guint64 nonvoluntary_ctxt_switches;
+    gboolean has_io;        // FALSE when io was not readable
+    ProcIo io;
+} ProcDetails;
+
+// A system-wide file such as /proc/stat, kept open between passes and read
+// again from offset 0 with pread() into a buffer that grows to fit it
+typedef struct {
+    const char *path;
+    int fd;                 // -1 until the first read
+    char *buf;
+    gsize size;
+} ProcfsFile;
+
+#define PROCFS_FILE_INIT(file_path) { (file_path), -1, NULL, 0 }
+
+// Tokenizer shared by the parsers of per-process and system-wide files:
+// fields are separated by spaces and read without sscanf or strtoull
+static inline const char *procfs_skip_spaces(const char *p, const char *end) {
+    while (p < end && *p == ' ') {
+        p++;
+    }
+    return p;
+}
+
+// Skip n space-separated fields
+static inline const char *procfs_skip_fields(const char *p, const char *end, int n) {
+    while (n-- > 0) {
+        p = procfs_skip_spaces(p, end);
+        while (p < end && *p != ' ' && *p != '\n') {
+            p++;
+        }
+    }
+    return p;
+}
+
+static inline const char *procfs_parse_u64(const char *p, const char *end, guint64 *out) {
+    guint64 value = 0;
+    p = procfs_skip_spaces(p, end);
+    while (p < end && *p >= '0' && *p <= '9') {
+        value = value * 10 + (guint64)(*p - '0');
+        p++;
+    }
+    *out = value;
+    return p;
+}
+
+// Start of the line after p, or end
+static inline const char *procfs_next_line(const char *p, const char *end) {
+    const char *newline = memchr(p, '\n', end - p);
+    return newline != NULL ? newline + 1 : end;
+}
+
+gssize procfs_file_read(ProcfsFile *file);
+void procfs_file_close(ProcfsFile *file);
+gboolean procfs_read_pid_stat(int proc_fd, pid_t pid, ProcStat *out);
+gboolean procfs_read_pid_details(int proc_fd, pid_t pid, ProcDetails *out);
+gboolean procfs_read_pid_io(int proc_fd, pid_t pid, ProcIo *out);
+gboolean procfs_read_task(int proc_fd, pid_t pid, pid_t tid, ProcDetails *out);
+gboolean procfs_parse_stat(const char *buf, gsize len, ProcStat *out);
+gboolean procfs_parse_statm(const char *buf, gsize len, ProcStat *out);
+void procfs_parse_status(const char *buf, gsize len, ProcDetails *out);
+gboolean procfs_parse_io(const char *buf, gsize len, ProcIo *out);
+guint64 procfs_boot_time(void);
+const gchar *procfs_state_name(char state);
+
+#endif
@@ -6,223 +6,530 @@
 
 #include <gtk/gtk.h>
 #include <cairo.h>
+#include <math.h>
 #include <stdio.h>
 
-#define CPU_HISTORY 60
-#define MEMORY_HISTORY 60
-#define NETWORK_HISTORY 60
-#define MAX_BANDWIDTH 20
-
-// Structs to hold memory usage and cpu usage data
-typedef struct _MemoryUsage {
-    float mem_usage[MEMORY_HISTORY];
-    float swap_usage[MEMORY_HISTORY];
-    int last;
-} MemoryUsage;
+#include "history.h"
+#include "sampler.h"
 
-typedef struct _CpuUsage {
-    float usage[CPU_HISTORY];
+#define CORE_HISTORY 60
+#define NETWORK_HISTORY 60
+#define GRAPH_POINTS 600    // most points a graph asks the history for
+#define PLOT_PAGES 2        // views of history a graph's plot strip holds
+
+// Spans the zoom buttons step through, in seconds
+static const gint64 view_spans[] = {
+    60, 5 * 60, 10 * 60, 30 * 60, 3600, 3 * 3600, 6 * 3600, 12 * 3600,
+    24 * 3600, 3 * 24 * 3600, HISTORY_MAX_SPAN,
+};
+
+// Per-core history as a struct of arrays: each kind is one block of
+// CORE_HISTORY slots of n_cpus floats, so a tick writes four contiguous rows.
+// heatmap mirrors it with one pixel per core and slot; a tick repaints only
+// its own pixel column.
+typedef struct _CoreUsage {
+    guint n_cpus;
     int last;
-} CpuUsage;
-
-typedef struct _NetworkUsage {
+    float *user;
+    float *system;
+    float *iowait;
+    float *steal;
+    cairo_surface_t *heatmap;   // CORE_HISTORY x n_cpus, ARGB32
+} CoreUsage;
+
+// Recent rates of one interface in bytes/s. Only the sum over all interfaces
+// goes into the long-term history; single interfaces show the last minute.
+typedef struct _InterfaceHistory {
+    char name[32];
     float received[NETWORK_HISTORY];
     float transmitted[NETWORK_HISTORY];
+} InterfaceHistory;
+
+typedef struct _NetworkUsage {
+    guint n_interfaces;
+    InterfaceHistory interfaces[SAMPLER_MAX_INTERFACES];
     int last;
+    int selected;                       // index into interfaces, -1 for all
 } NetworkUsage;
 
+// Time range the history graphs show
+typedef struct _GraphView {
+    guint span;         // index into view_spans
+    gint64 end;         // seconds since the epoch, 0 to follow the present
+} GraphView;
+
+// What a graph drew last, in surfaces similar to its window (pixmaps on X11)
+// so a tick does not send it again. chrome holds what changes only with the
+// size, theme or view: background, axes, grid, labels and title. plot is a
+// transparent strip PLOT_PAGES views wide holding the history lines, which
+// the view slides across.
+typedef struct _GraphCache {
+    int width;
+    int height;
+    double scale;               // full scale of the Y axis (cores for the heatmap)
+    cairo_surface_t *chrome;
+    cairo_surface_t *plot;
+    gint64 plot_start;          // time at the strip's left edge
+    gint64 plot_span;           // view span the strip was drawn for
+    gint64 plot_resolution;     // seconds per history point
+    gint64 drawn_until;         // points before this are on the strip
+} GraphCache;
+
+// A history series and the colour it is drawn in
+typedef struct _GraphSeries {
+    HistorySeries series;
+    double red;
+    double green;
+    double blue;
+} GraphSeries;
+
+static const GraphSeries cpu_series[] = {
+    { HISTORY_CPU, 0.3, 0.6, 0.9 },
+};
+static const GraphSeries memory_series[] = {
+    { HISTORY_MEMORY, 0.2, 0.8, 0.2 },
+    { HISTORY_SWAP, 0.8, 0.2, 0.2 },
+};
+static const GraphSeries network_series[] = {
+    { HISTORY_RECEIVED, 0, 0, 1 },
+    { HISTORY_TRANSMITTED, 1, 0, 0 },
+};
 
 // global variables
-static CpuUsage cpu;
-static MemoryUsage mem;
+static CoreUsage cores;
+static GraphView view = { 0, 0 };
 static GtkWidget *g_drawing_area = NULL;
+static GtkWidget *g_core_drawing_area = NULL;
 static GtkWidget *g_mem_drawing_area = NULL;
+static GtkWidget *g_net_drawing_area = NULL;
+static GtkWidget *g_net_selector = NULL;
+static GtkWidget *g_view_label = NULL;
+static guint resource_listener_id = 0;
+static guint resource_subscriptions[3];    // CPU, memory and network, while on screen
 static float global_memory_percentage;
 static float global_swap_percentage;
 static float total_memory_in_gib;
 static float total_swap_in_gib;
 static NetworkUsage net;
+static GraphCache cpu_cache;
+static GraphCache core_cache;
+static GraphCache mem_cache;
+static GraphCache net_cache;
 
 // Forward declaration
+static void graph_cache_clear(GraphCache *cache);
 static void draw_cpu_graph(GtkWidget *widget, cairo_t *cr);
 static void draw_memory_graph(GtkWidget *widget, cairo_t *cr);
-static void read_memory_usage();
-static void read_network_usage();
-
-// Function to read CPU usage from /proc/stat
-static float read_cpu_usage() {
-    static float last_non_zero_usage = -1.0f;
-    FILE *fp;
-    char buf[128];
-    unsigned long long int user, nice, system, idle, iowait, irq, softirq, steal, guest, guest_nice;
-    unsigned long long int all_time, idle_all_time, total_diff, idle_diff;
-    float usage;
+static void draw_core_heatmap(GtkWidget *widget, cairo_t *cr);
+
+static void free_core_usage(void) {
+    g_free(cores.user);
+    g_free(cores.system);
+    g_free(cores.iowait);
+    g_free(cores.steal);
+    g_clear_pointer(&cores.heatmap, cairo_surface_destroy);
+    memset(&cores, 0, sizeof(cores));
+}
 
-    fp = fopen("/proc/stat", "r");
-    if (!fp) {
-        perror("Error opening /proc/stat");
-        return -1.0f;
-    }
+// (Re)size the rings for n_cpus cores; history is dropped when the count changes
+static void reset_core_usage(guint n_cpus) {
+    free_core_usage();
+    cores.n_cpus = n_cpus;
+    cores.user = g_new0(float, CORE_HISTORY * n_cpus);
+    cores.system = g_new0(float, CORE_HISTORY * n_cpus);
+    cores.iowait = g_new0(float, CORE_HISTORY * n_cpus);
+    cores.steal = g_new0(float, CORE_HISTORY * n_cpus);
+    cores.heatmap = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, CORE_HISTORY, n_cpus);
+}
 
-    fgets(buf, sizeof(buf), fp);
-    sscanf(buf, "cpu %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu",
-           &user, &nice, &system, &idle, &iowait, &irq, &softirq, &steal, &guest, &guest_nice);
+// Busy cores go from pale yellow to red; waiting on I/O or on the hypervisor
+// pulls the colour towards blue, so a core stuck in iowait stands out from
+// one burning CPU
+static guint32 core_pixel(float busy, float waiting) {
+    float b = CLAMP(busy / 100.0f, 0.0f, 1.0f);
+    float w = CLAMP(waiting / 100.0f, 0.0f, 1.0f);
+    guint32 r = (guint32)(255 * (1.0f - w * 0.6f));
+    guint32 g = (guint32)(250 * (1.0f - b) * (1.0f - w * 0.3f));
+    guint32 bl = (guint32)(220 * (1.0f - b) + 200 * w * b);
+    return 0xff000000u | (MIN(r, 255) << 16) | (MIN(g, 255) << 8) | MIN(bl, 255);
+}
 
-    fclose(fp);
+static void apply_core_usage(const CoreSample *sample) {
+    if (sample->n_cpus == 0) {
+        return;
+    }
+    if (sample->n_cpus != cores.n_cpus) {
+        reset_core_usage(sample->n_cpus);
+    }
 
-    all_time = user + nice + system + idle + iowait + irq + softirq + steal;
-    idle_all_time = idle + iowait;
+    cores.last = (cores.last + 1) % CORE_HISTORY;
+    gsize offset = (gsize)cores.last * cores.n_cpus;
+    gsize size = cores.n_cpus * sizeof(float);
+    memcpy(cores.user + offset, sample->user, size);
+    memcpy(cores.system + offset, sample->system, size);
+    memcpy(cores.iowait + offset, sample->iowait, size);
+    memcpy(cores.steal + offset, sample->steal, size);
+
+    cairo_surface_flush(cores.heatmap);
+    unsigned char *data = cairo_image_surface_get_data(cores.heatmap);
+    int stride = cairo_image_surface_get_stride(cores.heatmap);
+    for (guint i = 0; i < cores.n_cpus; i++) {
+        guint32 *pixel = (guint32 *)(data + i * stride) + cores.last;
+        *pixel = core_pixel(sample->user[i] + sample->system[i], sample->iowait[i] + sample->steal[i]);
+    }
+    cairo_surface_mark_dirty_rectangle(cores.heatmap, cores.last, 0, 1, cores.n_cpus);
+}
 
-    static unsigned long long int prev_all_time = 0, prev_idle_all_time = 0;
+static void apply_memory_usage(const SystemSample *sample) {
+    unsigned long memTotal = sample->mem_total, memFree = sample->mem_free;
+    unsigned long swapTotal = sample->swap_total, swapFree = sample->swap_free;
 
-    if (prev_all_time == 0 || prev_idle_all_time == 0) {
-        prev_all_time = all_time;
-        prev_idle_all_time = idle_all_time;
-        return 0.0f;
+    if (memTotal == 0) {
+        return;
     }
 
-    total_diff = all_time - prev_all_time;
-    idle_diff = idle_all_time - prev_idle_all_time;
+    // Calculate usage as a percentage
+    global_memory_percentage = 100.0f * (1.0f - ((float)memFree / memTotal));
+    global_swap_percentage = swapTotal ? 100.0f * (1.0f - ((float)swapFree / swapTotal)) : 0.0f;
 
-    if (total_diff == 0 || idle_diff > total_diff) {
-        return last_non_zero_usage > 0 ? last_non_zero_usage : 0.0f;
-    }
+    total_memory_in_gib = memTotal / (1024.0f * 1024.0f);
+    total_swap_in_gib = swapTotal / (1024.0f * 1024.0f);
+}
 
-    usage = (float)(total_diff - idle_diff) / total_diff;
+static InterfaceHistory *find_interface(const char *name) {
+    for (guint i = 0; i < net.n_interfaces; i++) {
+        if (strcmp(net.interfaces[i].name, name) == 0) {
+            return &net.interfaces[i];
+        }
+    }
+    if (net.n_interfaces == SAMPLER_MAX_INTERFACES) {
+        return NULL;
+    }
 
-    // Check if usage is zero and if we have a previous non-zero value to use
-    if (usage == 0 && last_non_zero_usage > 0) {
-        usage = last_non_zero_usage;
-    } else if (usage > 0) {
-        last_non_zero_usage = usage;
+    InterfaceHistory *iface = &net.interfaces[net.n_interfaces++];
+    g_strlcpy(iface->name, name, sizeof(iface->name));
+    if (g_net_selector != NULL) {
+        gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(g_net_selector), name);
     }
+    return iface;
+}
 
-    prev_all_time = all_time;
-    prev_idle_all_time = idle_all_time;
+// Advance the ring by one slot; interfaces missing from the sample get 0
+static void apply_network_usage(const SystemSample *sample) {
+    net.last = (net.last + 1) % NETWORK_HISTORY;
+    for (guint i = 0; i < net.n_interfaces; i++) {
+        net.interfaces[i].received[net.last] = 0;
+        net.interfaces[i].transmitted[net.last] = 0;
+    }
 
-    return usage * 100.0f; // Convert to percentage
+    for (guint i = 0; i < sample->n_interfaces; i++) {
+        const InterfaceSample *in = &sample->interfaces[i];
+        InterfaceHistory *iface = find_interface(in->name);
+        if (iface != NULL) {
+            iface->received[net.last] = in->received_rate;
+            iface->transmitted[net.last] = in->transmitted_rate;
+        }
+    }
 }
 
-static gboolean update_resource_usage(gpointer user_data) {
-    // Update CPU
-    cpu.last = (cpu.last + 1) % CPU_HISTORY;
-    cpu.usage[cpu.last] = read_cpu_usage();
+// Called on the main loop with each finished snapshot from the sampler thread
+static void update_resource_usage(const Snapshot *snapshot, gpointer user_data) {
+    if (!(snapshot->contents & SNAPSHOT_SYSTEM)) {
+        return;
+    }
 
-    // Update Memory and Swap
-    mem.last = (mem.last + 1) % MEMORY_HISTORY;
-    read_memory_usage();
+    // The CPU, memory and total network graphs read the history store; only
+    // the per-core and per-interface views keep rings of their own
+    apply_core_usage(&snapshot->system.cores);
+    apply_memory_usage(&snapshot->system);
 
-    // Queue redraw for both CPU and Memory graphs
+    // Update Network
+    apply_network_usage(&snapshot->system);
+
+    // Queue redraw for the CPU, Memory and Network graphs
     if (g_drawing_area != NULL)
         gtk_widget_queue_draw(g_drawing_area);
+    if (g_core_drawing_area != NULL)
+        gtk_widget_queue_draw(g_core_drawing_area);
     if (g_mem_drawing_area != NULL)
         gtk_widget_queue_draw(g_mem_drawing_area);
-
-    return TRUE;
+    if (g_net_drawing_area != NULL)
+        gtk_widget_queue_draw(g_net_drawing_area);
 }
 
-static void read_network_usage() {
-    FILE *fp;
-    char buf[1024];
-    char *line;
-    unsigned long long int receive, transmit;
-
-    fp = fopen("/proc/net/dev", "r");
-    if (!fp) {
-        perror("Error opening /proc/net/dev");
-        return;
+// The graphs need every tick while on screen; the history keeps its own
+// subscriptions for the background
+static void on_graphs_map(GtkWidget *widget, gpointer user_data) {
+    if (resource_subscriptions[0] == 0) {
+        resource_subscriptions[0] = sampler_subscribe(SAMPLER_CPU, SAMPLER_INTERVAL_MS);
+        resource_subscriptions[1] = sampler_subscribe(SAMPLER_MEMORY, SAMPLER_INTERVAL_MS);
+        resource_subscriptions[2] = sampler_subscribe(SAMPLER_NETWORK, SAMPLER_INTERVAL_MS);
     }
+}
 
-    // Skip the first two lines (headers)
-    fgets(buf, sizeof(buf), fp);
-    fgets(buf, sizeof(buf), fp);
+static void on_graphs_unmap(GtkWidget *widget, gpointer user_data) {
+    for (guint i = 0; i < G_N_ELEMENTS(resource_subscriptions); i++) {
+        if (resource_subscriptions[i] != 0) {
+            sampler_unsubscribe(resource_subscriptions[i]);
+            resource_subscriptions[i] = 0;
+        }
+    }
+}
 
-    // Read data for each network interface
-    while ((line = fgets(buf, sizeof(buf), fp)) != NULL) {
-        // Example line: "eth0: 12345 0 0 0 0 0 0 0 67890 0 0 0 0 0 0 0"
-        char iface[128];
-        sscanf(line, "%s %llu %*d %*d %*d %*d %*d %*d %llu", iface, &receive, &transmit);
+// Stop listening once the graphs are torn down (e.g. when the tab is rebuilt)
+static void on_graphs_destroy(GtkWidget *widget, gpointer user_data) {
+    if (resource_listener_id != 0) {
+        sampler_remove_listener(resource_listener_id);
+        resource_listener_id = 0;
+    }
+    on_graphs_unmap(widget, NULL);
+    graph_cache_clear(&cpu_cache);
+    graph_cache_clear(&core_cache);
+    graph_cache_clear(&mem_cache);
+    graph_cache_clear(&net_cache);
+    g_drawing_area = NULL;
+    g_core_drawing_area = NULL;
+    g_mem_drawing_area = NULL;
+    g_net_drawing_area = NULL;
+    g_net_selector = NULL;
+    g_view_label = NULL;
+}
 
-        // You might want to filter out the loopback interface (lo) or others
-        if (strcmp(iface, "lo:") != 0) {
-            net.last = (net.last + 1) % MEMORY_HISTORY;
-            net.received[net.last] = receive;
-            net.transmitted[net.last] = transmit;
+// Smallest 1, 2 or 5 times a power of ten that is at least value
+static double nice_ceiling(double value) {
+    double magnitude = pow(10.0, floor(log10(value)));
+    double steps[] = { 1.0, 2.0, 5.0, 10.0 };
+    for (guint i = 0; i < G_N_ELEMENTS(steps); i++) {
+        if (steps[i] * magnitude >= value) {
+            return steps[i] * magnitude;
         }
     }
+    return 10.0 * magnitude;
+}
 
-    fclose(fp);
+// Network rates read as link speeds: bits per second, up to Gbit/s
+static void format_bit_rate(double bytes_per_second, char *buf, gsize size) {
+    double bits = bytes_per_second * 8.0;
+    if (bits >= 1e9) {
+        g_snprintf(buf, size, "%.3g Gbit/s", bits / 1e9);
+    } else if (bits >= 1e6) {
+        g_snprintf(buf, size, "%.3g Mbit/s", bits / 1e6);
+    } else if (bits >= 1e3) {
+        g_snprintf(buf, size, "%.3g kbit/s", bits / 1e3);
+    } else {
+        g_snprintf(buf, size, "%.0f bit/s", bits);
+    }
 }
 
-static void draw_network_graph(GtkWidget *widget, cairo_t *cr) {
-    GtkAllocation allocation;
-    gtk_widget_get_allocation(widget, &allocation);
-    int width = allocation.width;
-    int height = allocation.height;
+// Time range the history graphs show, in seconds since the epoch
+static void view_range(gint64 *start, gint64 *end) {
+    *end = view.end != 0 ? view.end : g_get_real_time() / G_USEC_PER_SEC;
+    *start = *end - view_spans[view.span];
+}
 
-    const int margin = 30;  // Margin for the graph
+static void format_span(gint64 seconds, char *buf, gsize size) {
+    if (seconds >= 24 * 3600) {
+        g_snprintf(buf, size, "%" G_GINT64_FORMAT "d", seconds / (24 * 3600));
+    } else if (seconds >= 3600) {
+        g_snprintf(buf, size, "%" G_GINT64_FORMAT "h", seconds / 3600);
+    } else if (seconds >= 60) {
+        g_snprintf(buf, size, "%" G_GINT64_FORMAT "m", seconds / 60);
+    } else {
+        g_snprintf(buf, size, "%" G_GINT64_FORMAT "s", seconds);
+    }
+}
 
-    // Clear the background
-    cairo_set_source_rgb(cr, 1, 1, 1); // White background
-    cairo_paint(cr);
+// "-10m" and "Now" while following the present, clock times once panned back
+static void draw_time_labels(cairo_t *cr, gint64 start, gint64 end, double left, double right, double y) {
+    char first[32], last[32];
+
+    if (view.end == 0) {
+        first[0] = '-';
+        format_span(end - start, first + 1, sizeof(first) - 1);
+        g_strlcpy(last, "Now", sizeof(last));
+    } else {
+        const char *format = end - start > 24 * 3600 ? "%a %H:%M" : "%H:%M:%S";
+        GDateTime *time = g_date_time_new_from_unix_local(start);
+        gchar *text = g_date_time_format(time, format);
+        g_strlcpy(first, text, sizeof(first));
+        g_free(text);
+        g_date_time_unref(time);
+
+        time = g_date_time_new_from_unix_local(end);
+        text = g_date_time_format(time, format);
+        g_strlcpy(last, text, sizeof(last));
+        g_free(text);
+        g_date_time_unref(time);
+    }
 
-    // Draw the axes
-    cairo_set_source_rgb(cr, 0, 0, 0); // Black color for axes
-    cairo_set_line_width(cr, 1.0);
+    cairo_text_extents_t extents;
+    cairo_text_extents(cr, last, &extents);
+    cairo_move_to(cr, left, y);
+    cairo_show_text(cr, first);
+    cairo_move_to(cr, right - extents.x_advance, y);
+    cairo_show_text(cr, last);
+}
 
-    // Draw the Y-axis
-    cairo_move_to(cr, margin, margin);
-    cairo_line_to(cr, margin, height - margin);
-    cairo_stroke(cr);
+// Faces are made once; selecting a toy face by name on every draw repeats
+// the font lookup each time
+static void set_font(cairo_t *cr, gboolean bold, double size) {
+    static cairo_font_face_t *faces[2];
+    if (faces[bold] == NULL) {
+        faces[bold] = cairo_toy_font_face_create("Sans", CAIRO_FONT_SLANT_NORMAL,
+                                                 bold ? CAIRO_FONT_WEIGHT_BOLD : CAIRO_FONT_WEIGHT_NORMAL);
+    }
+    cairo_set_font_face(cr, faces[bold]);
+    cairo_set_font_size(cr, size);
+}
 
-    // Draw the X-axis
-    cairo_move_to(cr, margin, height - margin);
-    cairo_line_to(cr, width - margin, height - margin);
-    cairo_stroke(cr);
+static void graph_cache_clear(GraphCache *cache) {
+    g_clear_pointer(&cache->chrome, cairo_surface_destroy);
+    g_clear_pointer(&cache->plot, cairo_surface_destroy);
+    memset(cache, 0, sizeof(*cache));
+}
 
-    // Draw horizontal lines for Y-axis
-    for (int i = 0; i <= MAX_BANDWIDTH; i += 4) {
-        int y = height - margin - ((float)i / MAX_BANDWIDTH) * (height - 2 * margin);
-        cairo_move_to(cr, margin, y);
-        cairo_line_to(cr, width - margin, y);
-        cairo_stroke(cr);
-        
-        // Draw Y-axis labels
-        char label[10];
-        snprintf(label, sizeof(label), "%d", i);
-        cairo_move_to(cr, margin - 20, y);
-        cairo_show_text(cr, label);
+// A theme change can change what the layers were drawn with
+static void graph_style_updated_cb(GtkWidget *widget, gpointer user_data) {
+    graph_cache_clear(user_data);
+}
+
+// Returns a context to draw the chrome on when the cached one is missing or
+// was drawn for another size or scale, NULL when it can be reused. A new
+// size or scale drops the plot strip as well.
+static cairo_t *graph_cache_begin(GraphCache *cache, GtkWidget *widget, int width, int height, double scale) {
+    if (cache->width != width || cache->height != height || cache->scale != scale) {
+        graph_cache_clear(cache);
+        cache->width = width;
+        cache->height = height;
+        cache->scale = scale;
+    } else if (cache->chrome != NULL) {
+        return NULL;
     }
 
-    // Draw labels for X-axis
-    for (int i = 0; i <= 60; i += 10) {
-        int x = margin + ((float)i / 60) * (width - 2 * margin);
-        cairo_move_to(cr, x, height - margin + 20);
-        char label[10];
-        snprintf(label, sizeof(label), "%d", 60 - i);
-        cairo_show_text(cr, label);
+    cache->chrome = gdk_window_create_similar_surface(gtk_widget_get_window(widget), CAIRO_CONTENT_COLOR,
+                                                      width, height);
+    return cairo_create(cache->chrome);
+}
+
+static void paint_chrome(cairo_t *cr, const GraphCache *cache) {
+    cairo_set_source_surface(cr, cache->chrome, 0, 0);
+    cairo_paint(cr);
+}
+
+// The average of each pair of neighbouring points as a line over their
+// min-max band, shaded in the same colour; points without samples leave a
+// gap. x is (time - origin) * x_scale. Bands are filled without antialiasing
+// so pairs drawn on different ticks meet without a seam.
+static void plot_segments(cairo_t *cr, const HistoryPoint *points, guint n_points, gint64 origin, double x_scale,
+                          double scale, double top, double bottom, const GraphSeries *series) {
+    double y_scale = (bottom - top) / scale;
+
+#define POINT_X(p) (((p)->time - origin) * x_scale)
+#define POINT_Y(v) (bottom - MIN((v) * y_scale, bottom - top))
+    cairo_save(cr);
+    cairo_set_antialias(cr, CAIRO_ANTIALIAS_NONE);
+    cairo_set_source_rgba(cr, series->red, series->green, series->blue, 0.2);
+    for (guint i = 1; i < n_points; i++) {
+        const HistoryPoint *a = &points[i - 1], *b = &points[i];
+        if (a->samples == 0 || b->samples == 0) {
+            continue;
+        }
+        cairo_move_to(cr, POINT_X(a), POINT_Y(a->max));
+        cairo_line_to(cr, POINT_X(b), POINT_Y(b->max));
+        cairo_line_to(cr, POINT_X(b), POINT_Y(b->min));
+        cairo_line_to(cr, POINT_X(a), POINT_Y(a->min));
+        cairo_close_path(cr);
     }
+    cairo_fill(cr);
+    cairo_restore(cr);
 
-    // Plot the network received data
-    cairo_set_source_rgb(cr, 0, 0, 1); // Blue color for received data
-    cairo_set_line_width(cr, 2.0);
-    for (int i = 0; i < NETWORK_HISTORY; i++) {
-        int x = margin + i * (width - 2 * margin) / NETWORK_HISTORY;
-        int y = height - margin - (net.received[(net.last + i) % NETWORK_HISTORY] / 100.0f) * (height - 2 * margin);
-        if (i == 0) {
-            cairo_move_to(cr, x, y);
-        } else {
-            cairo_line_to(cr, x, y);
+    cairo_set_source_rgb(cr, series->red, series->green, series->blue);
+    cairo_set_line_width(cr, 2);
+    cairo_set_line_cap(cr, CAIRO_LINE_CAP_ROUND);
+    for (guint i = 1; i < n_points; i++) {
+        const HistoryPoint *a = &points[i - 1], *b = &points[i];
+        if (a->samples == 0 || b->samples == 0) {
+            continue;
+        }
+        if (i == 1 || points[i - 2].samples == 0) {
+            cairo_move_to(cr, POINT_X(a), POINT_Y(a->avg));
         }
+        cairo_line_to(cr, POINT_X(b), POINT_Y(b->avg));
     }
     cairo_stroke(cr);
+    cairo_set_line_cap(cr, CAIRO_LINE_CAP_BUTT);
+#undef POINT_X
+#undef POINT_Y
+}
+
+// History of series between start and end over the plot area, through the
+// cache's strip. Points that are complete (their time has fully passed) are
+// drawn onto the strip once; only the newest, still filling, is drawn
+// straight to cr on every tick. The strip is redrawn when the span, the
+// resolution or the size changes, or when the view slides off its end.
+static void draw_history(cairo_t *cr, GraphCache *cache, GtkWidget *widget, const GraphSeries *series,
+                         guint n_series, gint64 start, gint64 end, double left, double right, double top,
+                         double bottom) {
+    gint64 span = MAX(end - start, 1);
+    gint64 resolution = history_resolution(start, end, GRAPH_POINTS);
+    double x_scale = (right - left) / span;
+    gint64 now = g_get_real_time() / G_USEC_PER_SEC;
+    gint64 complete = now - now % resolution;      // points before this are final
+    HistoryPoint points[GRAPH_POINTS];
+
+    if (cache->plot == NULL || cache->plot_span != span || cache->plot_resolution != resolution ||
+        start < cache->plot_start || end >= cache->plot_start + PLOT_PAGES * span) {
+        g_clear_pointer(&cache->plot, cairo_surface_destroy);
+        cache->plot = gdk_window_create_similar_surface(gtk_widget_get_window(widget), CAIRO_CONTENT_COLOR_ALPHA,
+                                                        (int)ceil(PLOT_PAGES * (right - left)) + 2, cache->height);
+        cache->plot_start = start - start % resolution;
+        cache->plot_span = span;
+        cache->plot_resolution = resolution;
+        cache->drawn_until = cache->plot_start;
+    }
 
-    // Plot the network transmitted data
-    cairo_set_source_rgb(cr, 1, 0, 0); // Red color for transmitted data
-    cairo_set_line_width(cr, 2.0);
+    // Segments start at the last point already on the strip
+    cairo_t *strip = cairo_create(cache->plot);
+    for (;;) {
+        gint64 from = MAX(cache->drawn_until - resolution, cache->plot_start);
+        gint64 until = MIN(end, complete - 1);
+        guint n_points = 0;
+        if (until < cache->drawn_until) {
+            break;
+        }
+        for (guint s = 0; s < n_series; s++) {
+            n_points = history_query(series[s].series, from, until, resolution, points, GRAPH_POINTS);
+            plot_segments(strip, points, n_points, cache->plot_start, x_scale, cache->scale, top, bottom, &series[s]);
+        }
+        if (n_points == 0) {
+            break;
+        }
+        cache->drawn_until = points[n_points - 1].time + resolution;
+    }
+    cairo_destroy(strip);
+
+    // Whole pixels only, so the strip is copied rather than resampled
+    cairo_save(cr);
+    cairo_rectangle(cr, left, 0, right - left, cache->height);
+    cairo_clip(cr);
+    cairo_translate(cr, left - round((start - cache->plot_start) * x_scale), 0);
+    cairo_set_source_surface(cr, cache->plot, 0, 0);
+    cairo_paint(cr);
+
+    gint64 from = MAX(cache->drawn_until - resolution, cache->plot_start);
+    for (guint s = 0; s < n_series; s++) {
+        guint n_points = history_query(series[s].series, from, end, resolution, points, GRAPH_POINTS);
+        plot_segments(cr, points, n_points, cache->plot_start, x_scale, cache->scale, top, bottom, &series[s]);
+    }
+    cairo_restore(cr);
+}
+
+// Line through the ring, oldest sample at left and the newest at right
+static void plot_rates(cairo_t *cr, const float *rates, double scale, double left, double right,
+                       double top, double bottom) {
     for (int i = 0; i < NETWORK_HISTORY; i++) {
-        int x = margin + i * (width - 2 * margin) / NETWORK_HISTORY;
-        int y = height - margin - (net.transmitted[(net.last + i) % NETWORK_HISTORY] / 100.0f) * (height - 2 * margin);
+        double x = left + i * (right - left) / (NETWORK_HISTORY - 1);
+        double y = bottom - MIN(rates[(net.last + 1 + i) % NETWORK_HISTORY] / scale, 1.0) * (bottom - top);
         if (i == 0) {
             cairo_move_to(cr, x, y);
         } else {
@@ -230,52 +537,142 @@ static void draw_network_graph(GtkWidget *widget, cairo_t *cr) {
         }
     }
     cairo_stroke(cr);
+}
 
-    // Add the title
-    cairo_set_source_rgb(cr, 0, 0, 0); // Black color for the title
-    cairo_select_font_face(cr, "Sans", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_BOLD);
-    cairo_set_font_size(cr, 16);
-    cairo_move_to(cr, width / 2 - 50, margin / 2);
-    cairo_show_text(cr, "Network History");
-
-    // Reset font for labels
-    cairo_select_font_face(cr, "Sans", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
-    cairo_set_font_size(cr, 12);
-
-    // Draw units label for Y-axis
-    cairo_move_to(cr, 5, margin / 2);
-    cairo_show_text(cr, "KiB/s");
-
-    // Draw time label for X-axis
-    cairo_move_to(cr, width - margin, height - 5);
-    cairo_show_text(cr, "seconds");
+// Highest rate in the points of a query
+static double peak_rate(HistorySeries series, gint64 start, gint64 end) {
+    HistoryPoint points[GRAPH_POINTS];
+    guint n_points = history_query(series, start, end, history_resolution(start, end, GRAPH_POINTS),
+                                   points, GRAPH_POINTS);
+    double peak = 0;
+    for (guint i = 0; i < n_points; i++) {
+        peak = MAX(peak, points[i].max);
+    }
+    return peak;
 }
 
-static gboolean update_network_usage(gpointer user_data) {
-    GtkWidget *widget = GTK_WIDGET(user_data);
+// Received and transmitted rate of all interfaces over the viewed range, or of
+// the selected interface over the last minute. The Y axis is rescaled on every
+// draw to a round value above the highest rate on screen, so a 100 GbE link
+// and an idle Wi-Fi card both fill the graph; the cached layers are redrawn
+// only when that value changes.
+static void draw_network_graph(GtkWidget *widget, cairo_t *cr) {
+    GtkAllocation allocation;
+    gtk_widget_get_allocation(widget, &allocation);
+    int width = allocation.width;
+    int height = allocation.height;
 
-    // Move to the next position in the history array
-    net.last = (net.last + 1) % NETWORK_HISTORY;
+    const int margin = 30;  // Margin for the graph
+    const int left_margin = 80;     // room for the rate labels
 
-    // Read the current network usage
-    read_network_usage();
+    const InterfaceHistory *iface = NULL;
+    gint64 start, end;
+    double peak = 0;
 
-    // Queue redraw of the network graph
-    gtk_widget_queue_draw(widget);
+    view_range(&start, &end);
+    if (net.selected >= 0 && (guint)net.selected < net.n_interfaces) {
+        iface = &net.interfaces[net.selected];
+        for (int i = 0; i < NETWORK_HISTORY; i++) {
+            peak = MAX(peak, MAX(iface->received[i], iface->transmitted[i]));
+        }
+    } else {
+        peak = MAX(peak_rate(HISTORY_RECEIVED, start, end), peak_rate(HISTORY_TRANSMITTED, start, end));
+    }
+    double scale = nice_ceiling(MAX(peak, 1024.0) * 8.0) / 8.0;    // round in bits
+
+    cairo_t *chrome = graph_cache_begin(&net_cache, widget, width, height, scale);
+    if (chrome != NULL) {
+        // Clear the background
+        cairo_set_source_rgb(chrome, 1, 1, 1); // White background
+        cairo_paint(chrome);
+
+        // Draw the axes
+        cairo_set_source_rgb(chrome, 0, 0, 0); // Black color for axes
+        cairo_set_line_width(chrome, 1.0);
+        cairo_move_to(chrome, left_margin, margin);
+        cairo_line_to(chrome, left_margin, height - margin);
+        cairo_line_to(chrome, width - margin, height - margin);
+        cairo_stroke(chrome);
+
+        // Horizontal grid lines at quarters of the scale, labelled with the rate
+        set_font(chrome, FALSE, 10);
+        for (int i = 1; i <= 4; i++) {
+            double y = height - margin - i * 0.25 * (height - 2 * margin);
+            char label[32];
+            format_bit_rate(scale * i / 4, label, sizeof(label));
+
+            cairo_set_source_rgba(chrome, 0.8, 0.8, 0.8, 0.5);
+            cairo_move_to(chrome, left_margin, y);
+            cairo_line_to(chrome, width - margin, y);
+            cairo_stroke(chrome);
+
+            cairo_set_source_rgb(chrome, 0, 0, 0);
+            cairo_move_to(chrome, 5, y + 4);
+            cairo_show_text(chrome, label);
+        }
 
-    return TRUE;
+        // Add the title
+        char title[64];
+        if (iface != NULL) {
+            g_snprintf(title, sizeof(title), "Network History: %s (last minute)", iface->name);
+        } else {
+            g_snprintf(title, sizeof(title), "Network History: All Interfaces");
+        }
+        cairo_set_source_rgb(chrome, 0, 0, 0); // Black color for the title
+        set_font(chrome, TRUE, 14);
+        cairo_move_to(chrome, width / 2 - margin, margin / 2);
+        cairo_show_text(chrome, title);
+
+        // Time axis
+        set_font(chrome, FALSE, 10);
+        if (iface != NULL) {
+            cairo_move_to(chrome, left_margin, height - 10);
+            cairo_show_text(chrome, "-60s");
+            cairo_move_to(chrome, width - margin - 30, height - 10);
+            cairo_show_text(chrome, "Now");
+        } else {
+            draw_time_labels(chrome, start, end, left_margin, width - margin, height - 10);
+        }
+        cairo_destroy(chrome);
+    }
+    paint_chrome(cr, &net_cache);
+
+    // Plot the received (blue) and transmitted (red) rates
+    if (iface != NULL) {
+        cairo_set_line_width(cr, 2.0);
+        cairo_set_source_rgb(cr, 0, 0, 1);
+        plot_rates(cr, iface->received, scale, left_margin, width - margin, margin, height - margin);
+        cairo_set_source_rgb(cr, 1, 0, 0);
+        plot_rates(cr, iface->transmitted, scale, left_margin, width - margin, margin, height - margin);
+
+        // The latest rates of a single interface
+        char rx[32], tx[32], key[96];
+        format_bit_rate(iface->received[net.last], rx, sizeof(rx));
+        format_bit_rate(iface->transmitted[net.last], tx, sizeof(tx));
+        g_snprintf(key, sizeof(key), "Received: %s    Sent: %s", rx, tx);
+        cairo_set_source_rgb(cr, 0, 0, 0);
+        set_font(cr, FALSE, 10);
+        cairo_move_to(cr, left_margin + 150, height - 10);
+        cairo_show_text(cr, key);
+    } else {
+        draw_history(cr, &net_cache, widget, network_series, G_N_ELEMENTS(network_series), start, end,
+                     left_margin, width - margin, margin, height - margin);
+    }
 }
 
+static void network_selector_changed_cb(GtkComboBox *combo, gpointer user_data) {
+    net.selected = gtk_combo_box_get_active(combo) - 1;    // entry 0 is "All interfaces"
+    graph_cache_clear(&net_cache);
+    if (g_net_drawing_area != NULL) {
+        gtk_widget_queue_draw(g_net_drawing_area);
+    }
+}
 
-// Function to draw the CPU graph with axes and title
-static void draw_cpu_graph(GtkWidget *widget, cairo_t *cr) {
-    GtkAllocation allocation;
-    gtk_widget_get_allocation(widget, &allocation);
-    int width = allocation.width;
-    int height = allocation.height;
-
+// Background, axes, dashed quarter lines, percentage labels, title and time
+// axis shared by the CPU and memory graphs
+static void draw_percent_chrome(cairo_t *cr, int width, int height, const char *title, gint64 start, gint64 end) {
     // Calculate the graph's margin
-    const int margin = 30;  
+    const int margin = 30;
 
     // Clear background
     cairo_set_source_rgb(cr, 1, 1, 1);
@@ -314,7 +711,7 @@ static void draw_cpu_graph(GtkWidget *widget, cairo_t *cr) {
     cairo_set_dash(cr, NULL, 0, 0);
 
     cairo_set_source_rgb(cr, 0, 0, 0); // Black color for text
-    cairo_set_font_size(cr, 10);
+    set_font(cr, FALSE, 10);
     const char *percentage_labels[] = {"100%", "75%", "50%", "25%"};
     for (int i = 0; i < 4; i++) {
         double y = margin + i * 0.25 * (height - 2 * margin);
@@ -322,163 +719,170 @@ static void draw_cpu_graph(GtkWidget *widget, cairo_t *cr) {
         cairo_show_text(cr, percentage_labels[i]);
     }
 
-    // Draw the CPU usage graph
-    // blue line for CPU
-    cairo_set_source_rgb(cr, 0.3, 0.6, 0.9);
-    cairo_set_line_width(cr, 2);
-
-    // Draw the CPU usage graph
-    for (int i = 0; i < CPU_HISTORY; i++) {
-        int x = margin + i * (width - 2 * margin) / CPU_HISTORY;
-        int y = margin + (1.0f - cpu.usage[(cpu.last + i) % CPU_HISTORY] / 100.0f) * (height - 2 * margin);
-        if (i == 0) {
-            cairo_move_to(cr, x, y);
-        } else {
-            cairo_line_to(cr, x, y);
-        }
-    }
-    cairo_stroke(cr);
-
-    const char *title = "Aggregate CPU History";
-    cairo_set_source_rgb(cr, 0, 0, 0);
-    cairo_select_font_face(cr, "Sans", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_BOLD);
-    cairo_set_font_size(cr, 14);
+    set_font(cr, TRUE, 14);
     cairo_move_to(cr, width / 2 - margin, margin / 2);
     cairo_show_text(cr, title);
 
-    cairo_set_font_size(cr, 10);
+    set_font(cr, FALSE, 10);
     cairo_move_to(cr, 5, margin / 2);
     cairo_show_text(cr, "100%");
     cairo_move_to(cr, 5, height - margin / 2);
     cairo_show_text(cr, "0%");
 
-    cairo_move_to(cr, margin, height - 10);
-    cairo_show_text(cr, "-60s");
-    cairo_move_to(cr, width - margin - 30, height - 10);
-    cairo_show_text(cr, "Now");
-
-    // Draw the key and percentage text at the bottom of the graph
-    int key_x = margin;
-    int key_y = height - margin + 20; // 20 pixels below the bottom margin
-
-    // Memory key and text
-    cairo_set_source_rgb(cr, 0.3, 0.6, 0.9); // Green for memory
-    cairo_fill(cr);
-    cairo_move_to(cr, key_x + 150, key_y);
-    char mem_text[256];
-    sprintf(mem_text, "CPUs (All)");
-    cairo_show_text(cr, mem_text);
+    draw_time_labels(cr, start, end, margin, width - margin, height - 10);
 }
 
-static void draw_memory_graph(GtkWidget *widget, cairo_t *cr) {
+// Function to draw the CPU graph with axes and title
+static void draw_cpu_graph(GtkWidget *widget, cairo_t *cr) {
     GtkAllocation allocation;
     gtk_widget_get_allocation(widget, &allocation);
     int width = allocation.width;
     int height = allocation.height;
 
     // Calculate the graph's margin
-    const int margin = 30;  
+    const int margin = 30;
 
-    // Clear background
-    cairo_set_source_rgb(cr, 1, 1, 1);
-    cairo_paint(cr);
+    gint64 start, end;
+    view_range(&start, &end);
 
-    // Draw the axes
-    cairo_set_source_rgb(cr, 0, 0, 0);
-    cairo_set_line_width(cr, 1);
+    cairo_t *chrome = graph_cache_begin(&cpu_cache, widget, width, height, 100.0);
+    if (chrome != NULL) {
+        draw_percent_chrome(chrome, width, height, "Aggregate CPU History", start, end);
 
-    // Y-axis
-    cairo_move_to(cr, margin, margin);
-    cairo_line_to(cr, margin, height - margin);
-    cairo_stroke(cr);
+        // Draw the key at the bottom of the graph, 20 pixels below the bottom margin
+        cairo_set_source_rgb(chrome, 0.3, 0.6, 0.9);
+        cairo_move_to(chrome, margin + 150, height - margin + 20);
+        cairo_show_text(chrome, "CPUs (All)");
+        cairo_destroy(chrome);
+    }
+    paint_chrome(cr, &cpu_cache);
 
-    // X-axis
-    cairo_move_to(cr, margin, height - margin);
-    cairo_line_to(cr, width - margin, height - margin);
-    cairo_stroke(cr);
+    // Draw the CPU usage graph, blue line over its min-max range
+    draw_history(cr, &cpu_cache, widget, cpu_series, G_N_ELEMENTS(cpu_series), start, end,
+                 margin, width - margin, margin, height - margin);
+}
 
-    // Set dashed line style for the horizontal lines
-    const double dashed1[] = {4.0};
-    int len1  = sizeof(dashed1) / sizeof(dashed1[0]);
-    cairo_set_dash(cr, dashed1, len1, 0);
+// One row per core, one column per second, oldest on the left. The heatmap
+// surface is scaled up with nearest-neighbour filtering, so drawing costs
+// the same two blits for 4 cores or 256.
+static void draw_core_heatmap(GtkWidget *widget, cairo_t *cr) {
+    GtkAllocation allocation;
+    gtk_widget_get_allocation(widget, &allocation);
+    int width = allocation.width;
+    int height = allocation.height;
 
-    cairo_set_source_rgba(cr, 0.8, 0.8, 0.8, 0.5);
-    cairo_set_line_width(cr, 1);
-    for (int i = 1; i < 5; i++) {
-        double y = margin + (1.0 - i * 0.25) * (height - 2 * margin);
-        cairo_move_to(cr, margin, y);
-        cairo_line_to(cr, width - margin, y);
-        cairo_stroke(cr);
+    const int margin = 30;
+    double plot_width = width - 2 * margin;
+    double plot_height = height - 2 * margin;
+
+    cairo_t *chrome = graph_cache_begin(&core_cache, widget, width, height, cores.n_cpus);
+    if (chrome != NULL) {
+        cairo_set_source_rgb(chrome, 1, 1, 1);
+        cairo_paint(chrome);
+
+        cairo_set_source_rgb(chrome, 0, 0, 0);
+        set_font(chrome, TRUE, 14);
+        cairo_move_to(chrome, width / 2 - margin, margin / 2);
+        cairo_show_text(chrome, "Per-Core CPU History");
+
+        set_font(chrome, FALSE, 10);
+        if (cores.n_cpus > 0) {
+            char label[16];
+            cairo_move_to(chrome, 5, margin + 10);
+            cairo_show_text(chrome, "0");
+            snprintf(label, sizeof(label), "%u", cores.n_cpus - 1);
+            cairo_move_to(chrome, 5, height - margin);
+            cairo_show_text(chrome, label);
+        }
+        cairo_move_to(chrome, margin, height - 10);
+        cairo_show_text(chrome, "-60s");
+        cairo_move_to(chrome, width - margin - 30, height - 10);
+        cairo_show_text(chrome, "Now");
+        cairo_destroy(chrome);
     }
-
-    // Reset the dashed line to default for the main graph line
-    cairo_set_dash(cr, NULL, 0, 0);
-
-    cairo_set_source_rgb(cr, 0, 0, 0);
-    cairo_set_font_size(cr, 10);
-    const char *percentage_labels[] = {"100%", "75%", "50%", "25%"};
-    for (int i = 0; i < 4; i++) {
-        double y = margin + i * 0.25 * (height - 2 * margin);
-        cairo_move_to(cr, width - margin + 5, y);
-        cairo_show_text(cr, percentage_labels[i]);
+    paint_chrome(cr, &core_cache);
+
+    if (cores.n_cpus > 0 && plot_width > 0 && plot_height > 0) {
+        // Slots after last are older than those up to it: draw them first
+        int oldest = (cores.last + 1) % CORE_HISTORY;
+        int first_part = CORE_HISTORY - oldest;
+        double column_width = plot_width / CORE_HISTORY;
+
+        cairo_save(cr);
+        cairo_rectangle(cr, margin, margin, plot_width, plot_height);
+        cairo_clip(cr);
+        cairo_translate(cr, margin, margin);
+        cairo_scale(cr, column_width, plot_height / cores.n_cpus);
+
+        cairo_set_source_surface(cr, cores.heatmap, -oldest, 0);
+        cairo_pattern_set_filter(cairo_get_source(cr), CAIRO_FILTER_NEAREST);
+        cairo_rectangle(cr, 0, 0, first_part, cores.n_cpus);
+        cairo_fill(cr);
+
+        if (oldest > 0) {
+            cairo_set_source_surface(cr, cores.heatmap, first_part, 0);
+            cairo_pattern_set_filter(cairo_get_source(cr), CAIRO_FILTER_NEAREST);
+            cairo_rectangle(cr, first_part, 0, oldest, cores.n_cpus);
+            cairo_fill(cr);
+        }
+        cairo_restore(cr);
     }
 
-    // Draw memory usage graph, GREEN
-    cairo_set_source_rgb(cr, 0.2, 0.8, 0.2);
-    cairo_set_line_width(cr, 2);
+    cairo_set_source_rgb(cr, 0, 0, 0);
+    cairo_set_line_width(cr, 1);
+    cairo_rectangle(cr, margin, margin, plot_width, plot_height);
+    cairo_stroke(cr);
 
-    for (int i = 0; i < MEMORY_HISTORY; i++) {
-        int x = margin + i * (width - 2 * margin) / MEMORY_HISTORY;
-        int y = margin + (1.0f - mem.mem_usage[(mem.last + i) % MEMORY_HISTORY] / 100.0f) * (height - 2 * margin);
-        if (i == 0) {
-            cairo_move_to(cr, x, y);
-        } else {
-            cairo_line_to(cr, x, y);
-        }
+    // Current averages over all cores
+    float user = 0, system = 0, iowait = 0, steal = 0;
+    gsize offset = (gsize)cores.last * cores.n_cpus;
+    for (guint i = 0; i < cores.n_cpus; i++) {
+        user += cores.user[offset + i];
+        system += cores.system[offset + i];
+        iowait += cores.iowait[offset + i];
+        steal += cores.steal[offset + i];
     }
-    cairo_stroke(cr);
+    if (cores.n_cpus > 0) {
+        char label[128];
+        snprintf(label, sizeof(label), "%u cores  user %.1f%%  system %.1f%%  iowait %.1f%%  steal %.1f%%",
+                 cores.n_cpus, user / cores.n_cpus, system / cores.n_cpus, iowait / cores.n_cpus,
+                 steal / cores.n_cpus);
+        set_font(cr, FALSE, 10);
+        cairo_move_to(cr, margin + 150, height - 10);
+        cairo_show_text(cr, label);
+    }
+}
 
-    // Draw swap usage graph, RED
-    cairo_set_source_rgb(cr, 0.8, 0.2, 0.2);
-    cairo_set_line_width(cr, 2);
+static void draw_memory_graph(GtkWidget *widget, cairo_t *cr) {
+    GtkAllocation allocation;
+    gtk_widget_get_allocation(widget, &allocation);
+    int width = allocation.width;
+    int height = allocation.height;
 
-    for (int i = 0; i < MEMORY_HISTORY; i++) {
-        int x = margin + i * (width - 2 * margin) / MEMORY_HISTORY;
-        int y = margin + (1.0f - mem.swap_usage[(mem.last + i) % MEMORY_HISTORY] / 100.0f) * (height - 2 * margin);
-        if (i == 0) {
-            cairo_move_to(cr, x, y);
-        } else {
-            cairo_line_to(cr, x, y);
-        }
-    }
-    cairo_stroke(cr);
+    // Calculate the graph's margin
+    const int margin = 30;
 
-    // Draw the title
-    const char *title = "Memory & Swap History";
-    cairo_set_source_rgb(cr, 0, 0, 0);
-    cairo_select_font_face(cr, "Sans", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_BOLD);
-    cairo_set_font_size(cr, 14);
-    cairo_move_to(cr, width / 2 - margin, margin / 2);
-    cairo_show_text(cr, title);
+    gint64 start, end;
+    view_range(&start, &end);
 
-    cairo_set_font_size(cr, 10);
-    cairo_move_to(cr, 5, margin / 2);
-    cairo_show_text(cr, "100%");
-    cairo_move_to(cr, 5, height - margin / 2);
-    cairo_show_text(cr, "0%");
+    cairo_t *chrome = graph_cache_begin(&mem_cache, widget, width, height, 100.0);
+    if (chrome != NULL) {
+        draw_percent_chrome(chrome, width, height, "Memory & Swap History", start, end);
+        cairo_destroy(chrome);
+    }
+    paint_chrome(cr, &mem_cache);
 
-    cairo_move_to(cr, margin, height - 10);
-    cairo_show_text(cr, "-60s");
-    cairo_move_to(cr, width - margin - 30, height - 10);
-    cairo_show_text(cr, "Now");
+    // Memory in green, swap in red
+    draw_history(cr, &mem_cache, widget, memory_series, G_N_ELEMENTS(memory_series), start, end,
+                 margin, width - margin, margin, height - margin);
 
     // Draw the key and percentage text at the bottom of the graph
     int key_x = margin;
     int key_y = height - margin + 20; // 20 pixels below the bottom margin
+    set_font(cr, FALSE, 10);
 
     // Memory key and text
     cairo_set_source_rgb(cr, 0.2, 0.8, 0.2); // Green for memory
-    cairo_fill(cr);
     cairo_move_to(cr, key_x + 150, key_y);
     char mem_text[256];
     sprintf(mem_text, "Memory: %.1f%% of %.1f GiB", global_memory_percentage, total_memory_in_gib);
@@ -486,71 +890,147 @@ static void draw_memory_graph(GtkWidget *widget, cairo_t *cr) {
 
     // Swap key and text
     cairo_set_source_rgb(cr, 0.8, 0.2, 0.2); // Red for swap
-    cairo_fill(cr);
     cairo_move_to(cr, key_x + 450, key_y);
     char swap_text[256];
     sprintf(swap_text, "Swap: %.1f%% of %.1f GiB", global_swap_percentage, total_swap_in_gib);
     cairo_show_text(cr, swap_text);
 }
 
-static void read_memory_usage() {
-    FILE *fp;
-    char buf[256];
-    unsigned long memTotal, memFree, swapTotal, swapFree;
-
-    fp = fopen("/proc/meminfo", "r");
-    if (!fp) {
-        perror("Error opening /proc/meminfo");
-        return;
+enum {
+    VIEW_ZOOM_OUT,
+    VIEW_ZOOM_IN,
+    VIEW_EARLIER,
+    VIEW_LATER,
+    VIEW_NOW,
+};
+
+static void update_view_label(void) {
+    char span[16], text[96];
+    format_span(view_spans[view.span], span, sizeof(span));
+
+    if (view.end == 0) {
+        g_snprintf(text, sizeof(text), "Last %s", span);
+    } else {
+        GDateTime *end = g_date_time_new_from_unix_local(view.end);
+        gchar *end_text = g_date_time_format(end, "%a %H:%M:%S");
+        g_snprintf(text, sizeof(text), "%s up to %s", span, end_text);
+        g_free(end_text);
+        g_date_time_unref(end);
     }
+    gtk_label_set_text(GTK_LABEL(g_view_label), text);
+}
 
-    while (fgets(buf, sizeof(buf), fp)) {
-        sscanf(buf, "MemTotal: %lu kB", &memTotal);
-        sscanf(buf, "MemFree: %lu kB", &memFree);
-        sscanf(buf, "SwapTotal: %lu kB", &swapTotal);
-        sscanf(buf, "SwapFree: %lu kB", &swapFree);
+// Zoom keeps the end of the range where it is; panning moves by half a span
+// and never past the present or the start of the kept history
+static void view_button_clicked_cb(GtkButton *button, gpointer user_data) {
+    gint64 now = g_get_real_time() / G_USEC_PER_SEC;
+    gint64 end = view.end != 0 ? view.end : now;
+
+    switch (GPOINTER_TO_INT(user_data)) {
+        case VIEW_ZOOM_OUT:
+            view.span = MIN(view.span + 1, G_N_ELEMENTS(view_spans) - 1);
+            break;
+        case VIEW_ZOOM_IN:
+            view.span = view.span > 0 ? view.span - 1 : 0;
+            break;
+        case VIEW_EARLIER:
+            end = MAX(end - view_spans[view.span] / 2, now - HISTORY_MAX_SPAN + view_spans[view.span]);
+            view.end = end < now ? end : 0;
+            break;
+        case VIEW_LATER:
+            end += view_spans[view.span] / 2;
+            view.end = end < now ? end : 0;
+            break;
+        case VIEW_NOW:
+            view.end = 0;
+            break;
     }
 
-    fclose(fp);
-
-    // Calculate usage as a percentage
-    mem.mem_usage[mem.last] = 100.0f * (1.0f - ((float)memFree / memTotal));
-    mem.swap_usage[mem.last] = 100.0f * (1.0f - ((float)swapFree / swapTotal));
-
-    total_memory_in_gib = memTotal / (1024.0f * 1024.0f);
-    total_swap_in_gib = swapTotal / (1024.0f * 1024.0f);
+    // Time labels change with the view; the plot strips check for themselves
+    update_view_label();
+    g_clear_pointer(&cpu_cache.chrome, cairo_surface_destroy);
+    g_clear_pointer(&mem_cache.chrome, cairo_surface_destroy);
+    g_clear_pointer(&net_cache.chrome, cairo_surface_destroy);
+    if (g_drawing_area != NULL)
+        gtk_widget_queue_draw(g_drawing_area);
+    if (g_mem_drawing_area != NULL)
+        gtk_widget_queue_draw(g_mem_drawing_area);
+    if (g_net_drawing_area != NULL)
+        gtk_widget_queue_draw(g_net_drawing_area);
+}
 
-    global_memory_percentage = (1.0f - ((float)memFree / memTotal)) * 100.0f;
-    global_swap_percentage = (1.0f - ((float)swapFree / swapTotal)) * 100.0f;
+static void add_view_button(GtkWidget *row, const gchar *label, gint action) {
+    GtkWidget *button = gtk_button_new_with_mnemonic(label);
+    g_signal_connect(button, "clicked", G_CALLBACK(view_button_clicked_cb), GINT_TO_POINTER(action));
+    gtk_box_pack_start(GTK_BOX(row), button, FALSE, FALSE, 0);
 }
 
 // Function to be called when the "Resources" tab is selected
 void display_resource_usage(GtkWidget *box) {
-    memset(&cpu, 0, sizeof(cpu));
-    memset(&mem, 0, sizeof(mem));
-    memset(&net, 0, sizeof(net));  
+    free_core_usage();
+    memset(&net, 0, sizeof(net));
+    net.selected = -1;
+
+    // Zoom and pan through the history; the view is kept across visits
+    GtkWidget *view_row = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 6);
+    g_view_label = gtk_label_new(NULL);
+    add_view_button(view_row, "Zoom _Out", VIEW_ZOOM_OUT);
+    add_view_button(view_row, "Zoom _In", VIEW_ZOOM_IN);
+    add_view_button(view_row, "_Earlier", VIEW_EARLIER);
+    add_view_button(view_row, "_Later", VIEW_LATER);
+    add_view_button(view_row, "_Now", VIEW_NOW);
+    gtk_box_pack_start(GTK_BOX(view_row), g_view_label, FALSE, FALSE, 6);
+    gtk_box_pack_start(GTK_BOX(box), view_row, FALSE, FALSE, 0);
+    update_view_label();
 
     // Create a drawing area for the CPU graph
     g_drawing_area = gtk_drawing_area_new();
     gtk_widget_set_size_request(g_drawing_area, 200, 100);
     g_signal_connect(G_OBJECT(g_drawing_area), "draw", G_CALLBACK(draw_cpu_graph), NULL);
+    g_signal_connect(G_OBJECT(g_drawing_area), "style-updated", G_CALLBACK(graph_style_updated_cb), &cpu_cache);
     gtk_box_pack_start(GTK_BOX(box), g_drawing_area, TRUE, TRUE, 0);
 
+    // Create a drawing area for the per-core heatmap
+    g_core_drawing_area = gtk_drawing_area_new();
+    gtk_widget_set_size_request(g_core_drawing_area, 200, 100);
+    g_signal_connect(G_OBJECT(g_core_drawing_area), "draw", G_CALLBACK(draw_core_heatmap), NULL);
+    g_signal_connect(G_OBJECT(g_core_drawing_area), "style-updated", G_CALLBACK(graph_style_updated_cb), &core_cache);
+    gtk_box_pack_start(GTK_BOX(box), g_core_drawing_area, TRUE, TRUE, 0);
+
     // Create a drawing area for the Memory and Swap graph
     g_mem_drawing_area = gtk_drawing_area_new();
     gtk_widget_set_size_request(g_mem_drawing_area, 200, 100);
     g_signal_connect(G_OBJECT(g_mem_drawing_area), "draw", G_CALLBACK(draw_memory_graph), NULL);
+    g_signal_connect(G_OBJECT(g_mem_drawing_area), "style-updated", G_CALLBACK(graph_style_updated_cb), &mem_cache);
     gtk_box_pack_start(GTK_BOX(box), g_mem_drawing_area, TRUE, TRUE, 0);
 
     // Create a drawing area for the Network graph
-    GtkWidget *g_net_drawing_area = gtk_drawing_area_new();
+    g_net_drawing_area = gtk_drawing_area_new();
     gtk_widget_set_size_request(g_net_drawing_area, 200, 100);
     g_signal_connect(G_OBJECT(g_net_drawing_area), "draw", G_CALLBACK(draw_network_graph), NULL);
-    gtk_box_pack_start(GTK_BOX(box), g_net_drawing_area, TRUE, TRUE, 0);
-
-    // Set up timeout functions to periodically update the graphs
-    g_timeout_add_seconds(1, (GSourceFunc)update_resource_usage, NULL);  // For CPU and Memory
-    g_timeout_add_seconds(1, (GSourceFunc)update_network_usage, g_net_drawing_area);  // For Network
+    g_signal_connect(G_OBJECT(g_net_drawing_area), "style-updated", G_CALLBACK(graph_style_updated_cb), &net_cache);
+
+    // Interface selector; interfaces are appended as they first show up
+    g_net_selector = gtk_combo_box_text_new();
+    gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(g_net_selector), "All interfaces");
+    gtk_combo_box_set_active(GTK_COMBO_BOX(g_net_selector), 0);
+    g_signal_connect(g_net_selector, "changed", G_CALLBACK(network_selector_changed_cb), NULL);
+
+    GtkWidget *net_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 2);
+    GtkWidget *selector_row = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 6);
+    gtk_box_pack_start(GTK_BOX(selector_row), gtk_label_new("Interface:"), FALSE, FALSE, 0);
+    gtk_box_pack_start(GTK_BOX(selector_row), g_net_selector, FALSE, FALSE, 0);
+    gtk_box_pack_start(GTK_BOX(net_box), selector_row, FALSE, FALSE, 0);
+    gtk_box_pack_start(GTK_BOX(net_box), g_net_drawing_area, TRUE, TRUE, 0);
+    gtk_box_pack_start(GTK_BOX(box), net_box, TRUE, TRUE, 0);
+
+    // Receive CPU, Memory and Network readings from the sampler thread
+    if (resource_listener_id == 0) {
+        resource_listener_id = sampler_add_listener(update_resource_usage, NULL);
+    }
+    g_signal_connect(G_OBJECT(g_drawing_area), "map", G_CALLBACK(on_graphs_map), NULL);
+    g_signal_connect(G_OBJECT(g_drawing_area), "unmap", G_CALLBACK(on_graphs_unmap), NULL);
+    g_signal_connect(G_OBJECT(g_drawing_area), "destroy", G_CALLBACK(on_graphs_destroy), NULL);
 
     gtk_widget_show_all(box);
 }
@@ -0,0 +1,1288 @@
+/*
+ * sampler.c
+ * Background thread that reads /proc and hands finished snapshots to the
+ * GTK main loop. Nothing in here may touch a widget; listeners run on the
+ * main thread from an idle callback.
+ */
+
+#include <gtk/gtk.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/statvfs.h>
+
+#include "proc_events.h"
+#include "sampler.h"
+#include "scan_pool.h"
+#include "user_cache.h"
+
+typedef struct {
+    guint id;
+    SnapshotListener func;
+    gpointer user_data;
+} ListenerEntry;
+
+typedef struct {
+    guint id;
+    SamplerCollector collector;
+    guint interval;             // ms
+} Subscription;
+
+// Schedule of one collector. next_run is on the monotonic clock, 0 to run as
+// soon as possible; otherwise it runs on the first tick at or after it.
+typedef struct {
+    guint interval;             // ms, the shortest any subscriber asked for
+    gint64 next_run;
+    CollectorStats stats;
+} CollectorState;
+
+// Previous CPU time of a PID, used to turn cumulative ticks into a percentage,
+// and for processes the previous I/O counters, turned into rates the same way
+typedef struct {
+    guint64 starttime;
+    guint64 cpu_time;
+    gint64 timestamp;
+    guint generation;
+    gboolean has_io;
+    guint64 read_bytes;
+    guint64 write_bytes;
+    guint64 syscalls;
+} CpuHistory;
+
+typedef struct {
+    GHashTable *entries;        // GINT_TO_POINTER(id) -> CpuHistory*
+    guint generation;
+    long clock_ticks;
+} CpuDeltaTable;
+
+// Shared between the sampler thread and the main thread, guarded by lock
+static GMutex lock;
+static GCond wakeup;
+static GThread *thread = NULL;
+static gboolean running = FALSE;
+static gboolean processes_requested = FALSE;
+static guint process_effective = 0;     // process interval after backing off
+static Snapshot *pending = NULL;    // published but not yet dispatched
+static GHashTable *thread_watches = NULL;   // GINT_TO_POINTER(pid) -> watch count
+static CollectorState collectors[N_SAMPLER_COLLECTORS];
+static GList *subscriptions = NULL;     // Subscription*
+static guint next_subscription_id = 1;
+
+// Sampler thread only
+static ScanPool *pool = NULL;
+static CpuDeltaTable process_cpu;
+static CpuDeltaTable thread_cpu;
+
+// Main thread only
+static GList *listeners = NULL;
+static guint next_listener_id = 1;
+static Snapshot *latest_system = NULL;
+static Snapshot *latest_processes = NULL;
+static Snapshot *latest_filesystems = NULL;
+
+static const gchar *collector_names[N_SAMPLER_COLLECTORS] = {
+    "CPU", "Memory", "Network", "Processes", "Threads", "File systems",
+};
+
+static Snapshot *snapshot_new(void) {
+    Snapshot *snapshot = g_new0(Snapshot, 1);
+    snapshot->ref_count = 1;
+    snapshot->timestamp = g_get_monotonic_time();
+    snapshot->real_time = g_get_real_time();
+    return snapshot;
+}
+
+Snapshot *snapshot_ref(const Snapshot *snapshot) {
+    Snapshot *s = (Snapshot *)snapshot;
+    g_atomic_int_inc(&s->ref_count);
+    return s;
+}
+
+void snapshot_unref(const Snapshot *snapshot) {
+    Snapshot *s = (Snapshot *)snapshot;
+    if (s == NULL || !g_atomic_int_dec_and_test(&s->ref_count)) {
+        return;
+    }
+    process_columns_free(s->processes);
+    thread_columns_free(s->threads);
+    if (s->filesystems != NULL) {
+        g_array_unref(s->filesystems);
+    }
+    g_free(s);
+}
+
+// Sampler thread only: system-wide files, kept open between passes
+static ProcfsFile stat_file = PROCFS_FILE_INIT("/proc/stat");
+static ProcfsFile meminfo_file = PROCFS_FILE_INIT("/proc/meminfo");
+static ProcfsFile net_dev_file = PROCFS_FILE_INIT("/proc/net/dev");
+static ProcfsFile mounts_file = PROCFS_FILE_INIT("/proc/mounts");
+
+// Aggregate CPU usage from the fields of the "cpu" line of /proc/stat
+static float aggregate_cpu_usage(const char *p, const char *end) {
+    static float last_non_zero_usage = -1.0f;
+    guint64 user, nice, system, idle, iowait, irq, softirq, steal;
+    guint64 all_time, idle_all_time, total_diff, idle_diff;
+    float usage;
+
+    p = procfs_parse_u64(p, end, &user);
+    p = procfs_parse_u64(p, end, &nice);
+    p = procfs_parse_u64(p, end, &system);
+    p = procfs_parse_u64(p, end, &idle);
+    p = procfs_parse_u64(p, end, &iowait);
+    p = procfs_parse_u64(p, end, &irq);
+    p = procfs_parse_u64(p, end, &softirq);
+    procfs_parse_u64(p, end, &steal);
+
+    all_time = user + nice + system + idle + iowait + irq + softirq + steal;
+    idle_all_time = idle + iowait;
+
+    static guint64 prev_all_time = 0, prev_idle_all_time = 0;
+
+    if (prev_all_time == 0 || prev_idle_all_time == 0) {
+        prev_all_time = all_time;
+        prev_idle_all_time = idle_all_time;
+        return 0.0f;
+    }
+
+    total_diff = all_time - prev_all_time;
+    idle_diff = idle_all_time - prev_idle_all_time;
+
+    if (total_diff == 0 || idle_diff > total_diff) {
+        return last_non_zero_usage > 0 ? last_non_zero_usage : 0.0f;
+    }
+
+    usage = (float)(total_diff - idle_diff) / total_diff;
+
+    // Check if usage is zero and if we have a previous non-zero value to use
+    if (usage == 0 && last_non_zero_usage > 0) {
+        usage = last_non_zero_usage;
+    } else if (usage > 0) {
+        last_non_zero_usage = usage;
+    }
+
+    prev_all_time = all_time;
+    prev_idle_all_time = idle_all_time;
+
+    return usage * 100.0f; // Convert to percentage
+}
+
+// Cumulative ticks of one core, folded into the kinds CoreSample reports
+typedef struct {
+    guint64 user;
+    guint64 system;
+    guint64 iowait;
+    guint64 steal;
+    guint64 total;      // the above plus idle
+} CoreTicks;
+
+// Sampler thread only: ticks of every core on the previous pass
+static CoreTicks prev_cores[SAMPLER_MAX_CPUS];
+
+static gfloat tick_share(guint64 now, guint64 before, guint64 total) {
+    return now >= before ? (now - before) * 100.0f / total : 0.0f;
+}
+
+// "12 4705 356 584 3699 23 23 0 0 0 0", the fields of the line of core 12:
+// store its usage since the previous pass in cores. A core seen for the first
+// time reads 0.
+static void apply_core_line(const char *p, const char *end, CoreSample *cores) {
+    guint64 cpu, user, nice, system, idle, iowait, irq, softirq, steal;
+
+    if (p == end || *p < '0' || *p > '9') {
+        return;
+    }
+    p = procfs_parse_u64(p, end, &cpu);
+    p = procfs_parse_u64(p, end, &user);
+    p = procfs_parse_u64(p, end, &nice);
+    p = procfs_parse_u64(p, end, &system);
+    p = procfs_parse_u64(p, end, &idle);
+    p = procfs_parse_u64(p, end, &iowait);
+    p = procfs_parse_u64(p, end, &irq);
+    p = procfs_parse_u64(p, end, &softirq);
+    procfs_parse_u64(p, end, &steal);
+    if (cpu >= SAMPLER_MAX_CPUS) {
+        return;
+    }
+
+    CoreTicks now = { user + nice, system + irq + softirq, iowait, steal, 0 };
+    now.total = now.user + now.system + now.iowait + now.steal + idle;
+
+    CoreTicks *before = &prev_cores[cpu];
+    if (before->total != 0 && now.total > before->total) {
+        guint64 total = now.total - before->total;
+        cores->user[cpu] = tick_share(now.user, before->user, total);
+        cores->system[cpu] = tick_share(now.system, before->system, total);
+        cores->iowait[cpu] = tick_share(now.iowait, before->iowait, total);
+        cores->steal[cpu] = tick_share(now.steal, before->steal, total);
+    }
+    *before = now;
+    cores->n_cpus = MAX(cores->n_cpus, cpu + 1);
+}
+
+// Aggregate and per-core usage from a single pass over /proc/stat, which is
+// costly to generate on large machines. The cpu lines come first, so parsing
+// stops at the first other line.
+static void read_cpu_usage(SystemSample *sample) {
+    gssize len = procfs_file_read(&stat_file);
+    if (len < 0) {
+        perror("Error reading /proc/stat");
+        sample->cpu_usage = -1.0f;
+        return;
+    }
+
+    const char *end = stat_file.buf + len;
+    for (const char *line = stat_file.buf; end - line > 3 && memcmp(line, "cpu", 3) == 0;
+         line = procfs_next_line(line, end)) {
+        if (line[3] == ' ') {
+            sample->cpu_usage = aggregate_cpu_usage(line + 3, end);
+        } else {
+            apply_core_line(line + 3, end, &sample->cores);
+        }
+    }
+}
+
+static const struct {
+    const char *key;
+    gsize offset;
+} meminfo_keys[] = {
+    { "MemTotal:", G_STRUCT_OFFSET(SystemSample, mem_total) },
+    { "MemFree:", G_STRUCT_OFFSET(SystemSample, mem_free) },
+    { "SwapTotal:", G_STRUCT_OFFSET(SystemSample, swap_total) },
+    { "SwapFree:", G_STRUCT_OFFSET(SystemSample, swap_free) },
+};
+
+// The kB figures of meminfo_keys. Parsing stops once all have been seen,
+// well before the end of the file.
+static void read_memory_usage(SystemSample *sample) {
+    gssize len = procfs_file_read(&meminfo_file);
+    if (len < 0) {
+        perror("Error reading /proc/meminfo");
+        return;
+    }
+
+    const char *end = meminfo_file.buf + len;
+    guint found = 0;
+    for (const char *line = meminfo_file.buf; line < end && found < G_N_ELEMENTS(meminfo_keys);
+         line = procfs_next_line(line, end)) {
+        for (guint i = 0; i < G_N_ELEMENTS(meminfo_keys); i++) {
+            gsize key_len = strlen(meminfo_keys[i].key);
+            if ((gsize)(end - line) > key_len && memcmp(line, meminfo_keys[i].key, key_len) == 0) {
+                guint64 value;
+                procfs_parse_u64(line + key_len, end, &value);
+                G_STRUCT_MEMBER(unsigned long, sample, meminfo_keys[i].offset) = value;
+                found++;
+                break;
+            }
+        }
+    }
+}
+
+// Sampler thread only: counters of each interface on the previous tick
+static InterfaceSample prev_interfaces[SAMPLER_MAX_INTERFACES];
+static guint n_prev_interfaces = 0;
+static gint64 prev_network_time = 0;
+
+// Largest delta a 32-bit counter is believed to have wrapped by in one tick
+#define MAX_WRAPPED_DELTA ((guint64)1 << 31)
+
+// Bytes counted between two readings. A counter that went backwards either
+// wrapped at 32 bits (some drivers still keep 32-bit counters) or was reset
+// with the interface (ifdown/up, a driver reload, a recreated veth), in which
+// case the interval is lost. Resets are far more common, so only a short
+// distance past the wrap counts as one; anything else reads 0 rather than a
+// spike that would stay in the history for days.
+static guint64 counter_delta(guint64 now, guint64 before) {
+    if (now >= before) {
+        return now - before;
+    }
+    if (before <= G_MAXUINT32) {
+        guint64 wrapped = now + ((guint64)G_MAXUINT32 + 1) - before;
+        if (wrapped < MAX_WRAPPED_DELTA) {
+            return wrapped;
+        }
+    }
+    return 0;
+}
+
+// Rates of every interface since the previous tick, over the real time
+// between the two reads; interfaces new on this tick report 0
+static void compute_network_rates(SystemSample *sample) {
+    gdouble seconds = (sample->network_time - prev_network_time) / (gdouble)G_USEC_PER_SEC;
+
+    for (guint i = 0; i < sample->n_interfaces && prev_network_time != 0 && seconds > 0; i++) {
+        InterfaceSample *now = &sample->interfaces[i];
+        for (guint j = 0; j < n_prev_interfaces; j++) {
+            const InterfaceSample *before = &prev_interfaces[j];
+            if (strcmp(before->name, now->name) == 0) {
+                now->received_rate = counter_delta(now->received, before->received) / seconds;
+                now->transmitted_rate = counter_delta(now->transmitted, before->transmitted) / seconds;
+                sample->received_rate += now->received_rate;
+                sample->transmitted_rate += now->transmitted_rate;
+                break;
+            }
+        }
+    }
+
+    memcpy(prev_interfaces, sample->interfaces, sample->n_interfaces * sizeof(InterfaceSample));
+    n_prev_interfaces = sample->n_interfaces;
+    prev_network_time = sample->network_time;
+}
+
+// Cumulative counters of every interface but loopback, with their rates
+static void read_network_usage(SystemSample *sample) {
+    gssize len = procfs_file_read(&net_dev_file);
+    if (len < 0) {
+        perror("Error reading /proc/net/dev");
+        return;
+    }
+    sample->network_time = g_get_monotonic_time();
+
+    // Skip the first two lines (headers)
+    const char *end = net_dev_file.buf + len;
+    const char *line = procfs_next_line(net_dev_file.buf, end);
+    line = procfs_next_line(line, end);
+
+    // Read data for each network interface
+    for (; line < end && sample->n_interfaces < SAMPLER_MAX_INTERFACES; line = procfs_next_line(line, end)) {
+        // Example line: "  eth0: 12345 0 0 0 0 0 0 0 67890 0 0 0 0 0 0 0". Large
+        // counters can run into the colon, so split there rather than on spaces.
+        const char *line_end = procfs_next_line(line, end);
+        const char *colon = memchr(line, ':', line_end - line);
+        if (colon == NULL) {
+            continue;
+        }
+        const char *name = procfs_skip_spaces(line, colon);
+        gsize name_len = colon - name;
+
+        // Leave out the loopback interface
+        if (name_len == 2 && memcmp(name, "lo", 2) == 0) {
+            continue;
+        }
+
+        guint64 receive, transmit;
+        const char *p = procfs_parse_u64(colon + 1, line_end, &receive);
+        p = procfs_skip_fields(p, line_end, 7);
+        procfs_parse_u64(p, line_end, &transmit);
+
+        InterfaceSample *out = &sample->interfaces[sample->n_interfaces++];
+        memset(out, 0, sizeof(*out));
+        memcpy(out->name, name, MIN(name_len, sizeof(out->name) - 1));
+        out->received = receive;
+        out->transmitted = transmit;
+    }
+
+    compute_network_rates(sample);
+}
+
+// Copy the space-separated field at p to dest, truncated to fit, and return
+// the end of the field
+static const char *copy_field(const char *p, const char *end, gchar *dest, gsize size) {
+    const char *field = procfs_skip_spaces(p, end);
+    p = procfs_skip_fields(field, end, 1);
+
+    gsize len = MIN((gsize)(p - field), size - 1);
+    memcpy(dest, field, len);
+    dest[len] = '\0';
+    return p;
+}
+
+// Every mount in /proc/mounts that statvfs can read. A hung network mount
+// blocks statvfs, which shows in this collector's cost.
+static GArray *read_filesystems(void) {
+    GArray *filesystems = g_array_new(FALSE, TRUE, sizeof(FileSystemSample));
+    gssize len = procfs_file_read(&mounts_file);
+    if (len < 0) {
+        perror("Error reading /proc/mounts");
+        return filesystems;
+    }
+
+    const char *end = mounts_file.buf + len;
+    for (const char *line = mounts_file.buf; line < end; line = procfs_next_line(line, end)) {
+        FileSystemSample fs = { 0 };
+        struct statvfs vfs;
+
+        const char *p = copy_field(line, end, fs.device, sizeof(fs.device));
+        p = copy_field(p, end, fs.mount_point, sizeof(fs.mount_point));
+        copy_field(p, end, fs.type, sizeof(fs.type));
+        if (fs.type[0] == '\0' || statvfs(fs.mount_point, &vfs) != 0) {
+            continue;
+        }
+
+        fs.total = (guint64)vfs.f_blocks * vfs.f_frsize;
+        fs.free = (guint64)vfs.f_bfree * vfs.f_frsize;
+        fs.available = (guint64)vfs.f_bavail * vfs.f_frsize;
+        g_array_append_val(filesystems, fs);
+    }
+
+    return filesystems;
+}
+
+// CPU, memory and network readings as taken on a tick, for the benchmarks.
+// Sampler thread only while the sampler runs.
+void sampler_collect_system(SystemSample *sample) {
+    read_cpu_usage(sample);
+    read_memory_usage(sample);
+    read_network_usage(sample);
+}
+
+#define SCAN_SHARD_SIZE 64
+
+// Carve every column out of one block, widest types first so each stays aligned
+ProcessColumns *process_columns_new(guint capacity) {
+    gsize row_size = 2 * sizeof(long) + 5 * sizeof(guint64) + sizeof(const gchar *) +
+                     5 * sizeof(gfloat) + sizeof(guint32) + PROCFS_COMM_LEN + sizeof(char);
+    ProcessColumns *columns = g_malloc0(sizeof(ProcessColumns) + row_size * MAX(capacity, 1));
+    char *p = (char *)(columns + 1);
+
+    columns->pid = (long *)p;              p += capacity * sizeof(long);
+    columns->ppid = (long *)p;             p += capacity * sizeof(long);
+    columns->starttime = (guint64 *)p;     p += capacity * sizeof(guint64);
+    columns->cpu_time = (guint64 *)p;      p += capacity * sizeof(guint64);
+    columns->read_bytes = (guint64 *)p;    p += capacity * sizeof(guint64);
+    columns->write_bytes = (guint64 *)p;   p += capacity * sizeof(guint64);
+    columns->syscalls = (guint64 *)p;      p += capacity * sizeof(guint64);
+    columns->user = (const gchar **)p;     p += capacity * sizeof(const gchar *);
+    columns->memory = (gfloat *)p;         p += capacity * sizeof(gfloat);
+    columns->cpu_usage = (gfloat *)p;      p += capacity * sizeof(gfloat);
+    columns->read_rate = (gfloat *)p;      p += capacity * sizeof(gfloat);
+    columns->write_rate = (gfloat *)p;     p += capacity * sizeof(gfloat);
+    columns->syscall_rate = (gfloat *)p;   p += capacity * sizeof(gfloat);
+    columns->name_id = (guint32 *)p;       p += capacity * sizeof(guint32);
+    columns->name = (char (*)[PROCFS_COMM_LEN])p; p += capacity * PROCFS_COMM_LEN;
+    columns->state = p;
+
+    return columns;
+}
+
+void process_columns_free(ProcessColumns *columns) {
+    if (columns == NULL) {
+        return;
+    }
+    g_free(columns->name_row);
+    g_free(columns->name_lower);
+    g_free(columns->name_rank);
+    g_free(columns);
+}
+
+static gint compare_name_ids(gconstpointer a, gconstpointer b, gpointer user_data) {
+    const ProcessColumns *columns = user_data;
+    return strcmp(columns->name_lower[*(const guint32 *)a], columns->name_lower[*(const guint32 *)b]);
+}
+
+// Number the distinct names of a filled table and rank them alphabetically, so
+// sorting by name compares integers. Process names repeat heavily
+// (kworker, postgres, php-fpm ...), so the index is much smaller than the table.
+void process_columns_index_names(ProcessColumns *columns) {
+    static gint next_serial = 0;
+    GHashTable *ids = g_hash_table_new(g_str_hash, g_str_equal);   // name -> id + 1
+
+    g_free(columns->name_row);
+    g_free(columns->name_lower);
+    g_free(columns->name_rank);
+    columns->serial = (guint)g_atomic_int_add(&next_serial, 1) + 1;
+    columns->n_names = 0;
+
+    for (guint i = 0; i < columns->len; i++) {
+        guint id = GPOINTER_TO_UINT(g_hash_table_lookup(ids, columns->name[i]));
+        if (id == 0) {
+            id = ++columns->n_names;
+            g_hash_table_insert(ids, columns->name[i], GUINT_TO_POINTER(id));
+        }
+        columns->name_id[i] = id - 1;
+    }
+    g_hash_table_destroy(ids);
+
+    columns->name_row = g_new(guint32, MAX(columns->n_names, 1));
+    columns->name_lower = g_malloc(MAX(columns->n_names, 1) * PROCFS_COMM_LEN);
+    for (guint i = columns->len; i-- > 0;) {
+        columns->name_row[columns->name_id[i]] = i;
+    }
+    for (guint id = 0; id < columns->n_names; id++) {
+        const char *name = columns->name[columns->name_row[id]];
+        for (guint c = 0; c < PROCFS_COMM_LEN; c++) {
+            columns->name_lower[id][c] = g_ascii_tolower(name[c]);
+        }
+    }
+
+    guint32 *order = g_new(guint32, MAX(columns->n_names, 1));
+    for (guint id = 0; id < columns->n_names; id++) {
+        order[id] = id;
+    }
+    g_qsort_with_data(order, columns->n_names, sizeof(guint32), compare_name_ids, columns);
+    columns->name_rank = g_new(guint32, MAX(columns->n_names, 1));
+    for (guint rank = 0; rank < columns->n_names; rank++) {
+        columns->name_rank[order[rank]] = rank;
+    }
+    g_free(order);
+}
+
+void process_columns_copy_row(ProcessColumns *dst, guint dst_row, const ProcessColumns *src, guint src_row) {
+    dst->pid[dst_row] = src->pid[src_row];
+    dst->ppid[dst_row] = src->ppid[src_row];
+    dst->starttime[dst_row] = src->starttime[src_row];
+    dst->cpu_time[dst_row] = src->cpu_time[src_row];
+    dst->user[dst_row] = src->user[src_row];
+    dst->memory[dst_row] = src->memory[src_row];
+    dst->cpu_usage[dst_row] = src->cpu_usage[src_row];
+    dst->read_bytes[dst_row] = src->read_bytes[src_row];
+    dst->write_bytes[dst_row] = src->write_bytes[src_row];
+    dst->syscalls[dst_row] = src->syscalls[src_row];
+    dst->read_rate[dst_row] = src->read_rate[src_row];
+    dst->write_rate[dst_row] = src->write_rate[src_row];
+    dst->syscall_rate[dst_row] = src->syscall_rate[src_row];
+    memcpy(dst->name[dst_row], src->name[src_row], PROCFS_COMM_LEN);
+    dst->state[dst_row] = src->state[src_row];
+}
+
+// One parallel walk of /proc: PIDs are listed up front, then parsed in shards
+typedef struct {
+    int proc_fd;                // open /proc directory shared by all workers
+    long page_size;
+    GArray *pids;               // long
+    ProcessColumns *columns;    // one row per PID, written by exactly one task
+    gboolean *valid;
+} ProcessScan;
+
+static void scan_shard(guint shard, gpointer user_data) {
+    ProcessScan *scan = user_data;
+    ProcessColumns *columns = scan->columns;
+    guint first = shard * SCAN_SHARD_SIZE;
+    guint last = MIN(first + SCAN_SHARD_SIZE, scan->pids->len);
+    ProcStat stat;
+    ProcIo io;
+
+    for (guint i = first; i < last; i++) {
+        columns->pid[i] = g_array_index(scan->pids, long, i);
+        if (!procfs_read_pid_stat(scan->proc_fd, columns->pid[i], &stat)) {
+            continue;
+        }
+
+        memcpy(columns->name[i], stat.comm, PROCFS_COMM_LEN);
+        columns->state[i] = stat.state;
+        columns->ppid[i] = stat.ppid;
+        columns->memory[i] = stat.size * scan->page_size / 1024.0 / 1024.0; // Convert to MiB
+        columns->user[i] = user_cache_lookup(stat.uid);
+        columns->starttime[i] = stat.starttime;
+        columns->cpu_time[i] = stat.utime + stat.stime;
+
+        // Rates are filled in from the deltas once the scan is merged
+        if (procfs_read_pid_io(scan->proc_fd, columns->pid[i], &io)) {
+            columns->read_bytes[i] = io.read_bytes;
+            columns->write_bytes[i] = io.write_bytes;
+            columns->syscalls[i] = io.syscr + io.syscw;
+        } else {
+            columns->read_rate[i] = -1.0f;
+            columns->write_rate[i] = -1.0f;
+            columns->syscall_rate[i] = -1.0f;
+        }
+        scan->valid[i] = TRUE;
+    }
+}
+
+// Collect one row per readable PID, parsing the PIDs in shards across the
+// pool. The PIDs come from the process event tracker while it is running and
+// up to date, otherwise from a readdir() of /proc, which also resynchronises
+// the tracker. Rows keep the listing order.
+ProcessColumns *sampler_collect_processes(ScanPool *pool) {
+    DIR *dir = opendir("/proc");
+    if (dir == NULL) {
+        perror("Failed to open /proc directory");
+        return process_columns_new(0);
+    }
+
+    // Pick up account changes before resolving any owners
+    user_cache_revalidate();
+
+    ProcessScan scan;
+    scan.proc_fd = dirfd(dir);
+    scan.page_size = sysconf(_SC_PAGESIZE);
+    scan.pids = proc_events_copy_pids();
+
+    if (scan.pids == NULL) {
+        gint64 listed_at = g_get_real_time();
+        scan.pids = g_array_new(FALSE, FALSE, sizeof(long));
+
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            // Only consider numeric directories
+            if (entry->d_type != DT_DIR || !isdigit(entry->d_name[0])) {
+                continue;
+            }
+            long pid = strtol(entry->d_name, NULL, 10);
+            g_array_append_val(scan.pids, pid);
+        }
+        proc_events_reconcile(scan.pids, listed_at);
+    }
+
+    scan.columns = process_columns_new(scan.pids->len);
+    scan.valid = g_new0(gboolean, scan.pids->len);
+
+    guint n_shards = (scan.pids->len + SCAN_SHARD_SIZE - 1) / SCAN_SHARD_SIZE;
+    scan_pool_run(pool, n_shards, scan_shard, &scan);
+    closedir(dir);
+
+    // Merge the shards into one table, dropping PIDs that exited mid-scan
+    ProcessColumns *columns = scan.columns;
+    for (guint i = 0; i < scan.pids->len; i++) {
+        if (scan.valid[i]) {
+            if (columns->len != i) {
+                process_columns_copy_row(columns, columns->len, columns, i);
+            }
+            columns->len++;
+        }
+    }
+
+    process_columns_index_names(columns);
+
+    g_free(scan.valid);
+    g_array_unref(scan.pids);
+    return columns;
+}
+
+// Same single-block layout as process_columns_new()
+static ThreadColumns *thread_columns_new(guint capacity) {
+    gsize row_size = 2 * sizeof(long) + 4 * sizeof(guint64) + sizeof(gfloat) + sizeof(gint) +
+                     PROCFS_COMM_LEN + sizeof(char);
+    ThreadColumns *columns = g_malloc0(sizeof(ThreadColumns) + row_size * MAX(capacity, 1));
+    char *p = (char *)(columns + 1);
+
+    columns->pid = (long *)p;                      p += capacity * sizeof(long);
+    columns->tid = (long *)p;                      p += capacity * sizeof(long);
+    columns->starttime = (guint64 *)p;             p += capacity * sizeof(guint64);
+    columns->cpu_time = (guint64 *)p;              p += capacity * sizeof(guint64);
+    columns->voluntary_switches = (guint64 *)p;    p += capacity * sizeof(guint64);
+    columns->involuntary_switches = (guint64 *)p;  p += capacity * sizeof(guint64);
+    columns->cpu_usage = (gfloat *)p;              p += capacity * sizeof(gfloat);
+    columns->processor = (gint *)p;                p += capacity * sizeof(gint);
+    columns->name = (char (*)[PROCFS_COMM_LEN])p;  p += capacity * PROCFS_COMM_LEN;
+    columns->state = p;
+
+    return columns;
+}
+
+void thread_columns_free(ThreadColumns *columns) {
+    g_free(columns);
+}
+
+// Collect one row per thread of each of pids (long). The task directories are
+// listed first so the columns are sized once; threads that exit before their
+// stat is read are dropped.
+ThreadColumns *sampler_collect_threads(const GArray *pids) {
+    GArray *tasks = g_array_new(FALSE, FALSE, sizeof(long) * 2);    // {pid, tid}
+    int proc_fd = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    char path[32];
+
+    for (guint i = 0; proc_fd >= 0 && i < pids->len; i++) {
+        long task[2] = { g_array_index(pids, long, i), 0 };
+        g_snprintf(path, sizeof(path), "%ld/task", task[0]);
+
+        int task_fd = openat(proc_fd, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        DIR *dir = task_fd >= 0 ? fdopendir(task_fd) : NULL;
+        if (dir == NULL) {
+            if (task_fd >= 0) {
+                close(task_fd);
+            }
+            continue;
+        }
+
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (isdigit(entry->d_name[0])) {
+                task[1] = strtol(entry->d_name, NULL, 10);
+                g_array_append_val(tasks, task);
+            }
+        }
+        closedir(dir);
+    }
+
+    ThreadColumns *columns = thread_columns_new(tasks->len);
+    ProcDetails details;
+
+    for (guint i = 0; i < tasks->len; i++) {
+        const long *task = &g_array_index(tasks, long, i * 2);
+        guint row = columns->len;
+        if (!procfs_read_task(proc_fd, task[0], task[1], &details)) {
+            continue;
+        }
+
+        columns->pid[row] = task[0];
+        columns->tid[row] = task[1];
+        columns->starttime[row] = details.stat.starttime;
+        columns->cpu_time[row] = details.stat.utime + details.stat.stime;
+        columns->voluntary_switches[row] = details.voluntary_ctxt_switches;
+        columns->involuntary_switches[row] = details.nonvoluntary_ctxt_switches;
+        columns->processor[row] = details.stat.processor;
+        memcpy(columns->name[row], details.stat.comm, PROCFS_COMM_LEN);
+        columns->state[row] = details.stat.state;
+        columns->len++;
+    }
+
+    if (proc_fd >= 0) {
+        close(proc_fd);
+    }
+    g_array_unref(tasks);
+    return columns;
+}
+
+static void cpu_delta_init(CpuDeltaTable *table) {
+    table->entries = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+    table->generation = 0;
+    table->clock_ticks = sysconf(_SC_CLK_TCK);
+}
+
+static void cpu_delta_clear(CpuDeltaTable *table) {
+    g_clear_pointer(&table->entries, g_hash_table_destroy);
+}
+
+// Find or start the history of id for a sample taken at timestamp. seconds is
+// the time since the previous sample, or 0 when there is nothing to compare
+// against: a new ID, or a changed starttime, meaning the ID was reused by a
+// new task.
+static CpuHistory *cpu_delta_touch(CpuDeltaTable *table, long id, guint64 starttime,
+                                   gint64 timestamp, gdouble *seconds) {
+    CpuHistory *entry = g_hash_table_lookup(table->entries, GINT_TO_POINTER(id));
+    *seconds = 0.0;
+
+    if (entry == NULL) {
+        entry = g_new0(CpuHistory, 1);
+        g_hash_table_insert(table->entries, GINT_TO_POINTER(id), entry);
+    } else if (entry->starttime == starttime && timestamp > entry->timestamp) {
+        *seconds = (timestamp - entry->timestamp) / (double)G_USEC_PER_SEC;
+    } else {
+        entry->has_io = FALSE;
+    }
+
+    entry->starttime = starttime;
+    entry->timestamp = timestamp;
+    entry->generation = table->generation;
+    return entry;
+}
+
+// Store the current CPU time of entry and return its usage since the previous
+// sample, as a percentage of one CPU
+static gfloat cpu_delta_usage(CpuDeltaTable *table, CpuHistory *entry, guint64 cpu_time, gdouble seconds) {
+    gfloat usage = 0.0f;
+    if (seconds > 0.0 && cpu_time >= entry->cpu_time) {
+        usage = (cpu_time - entry->cpu_time) * 100.0 / table->clock_ticks / seconds;
+    }
+    entry->cpu_time = cpu_time;
+    return usage;
+}
+
+// Record the current CPU time of id and return its usage since the previous
+// call, as a percentage of one CPU
+static gfloat cpu_delta_update(CpuDeltaTable *table, long id, guint64 starttime,
+                               guint64 cpu_time, gint64 timestamp) {
+    gdouble seconds;
+    CpuHistory *entry = cpu_delta_touch(table, id, starttime, timestamp, &seconds);
+    return cpu_delta_usage(table, entry, cpu_time, seconds);
+}
+
+static gfloat counter_rate(guint64 now, guint64 before, gdouble seconds) {
+    return now >= before ? (now - before) / seconds : 0.0f;
+}
+
+static gboolean is_stale_history(gpointer key, gpointer value, gpointer user_data) {
+    const CpuHistory *entry = value;
+    const CpuDeltaTable *table = user_data;
+    return entry->generation != table->generation;
+}
+
+// Start a new pass; entries not updated during the previous pass are dropped
+static void cpu_delta_begin(CpuDeltaTable *table) {
+    g_hash_table_foreach_remove(table->entries, is_stale_history, table);
+    table->generation++;
+}
+
+// CPU usage and I/O rates of every row. Rows whose io could not be read keep
+// their -1 rates; a row that just became readable has no rate yet.
+static void update_process_usage(ProcessColumns *processes, gint64 timestamp) {
+    cpu_delta_begin(&process_cpu);
+    for (guint i = 0; i < processes->len; i++) {
+        gdouble seconds;
+        CpuHistory *entry = cpu_delta_touch(&process_cpu, processes->pid[i], processes->starttime[i],
+                                            timestamp, &seconds);
+        processes->cpu_usage[i] = cpu_delta_usage(&process_cpu, entry, processes->cpu_time[i], seconds);
+
+        if (processes->read_rate[i] < 0.0f) {
+            entry->has_io = FALSE;
+            continue;
+        }
+        if (entry->has_io && seconds > 0.0) {
+            processes->read_rate[i] = counter_rate(processes->read_bytes[i], entry->read_bytes, seconds);
+            processes->write_rate[i] = counter_rate(processes->write_bytes[i], entry->write_bytes, seconds);
+            processes->syscall_rate[i] = counter_rate(processes->syscalls[i], entry->syscalls, seconds);
+        }
+        entry->has_io = TRUE;
+        entry->read_bytes = processes->read_bytes[i];
+        entry->write_bytes = processes->write_bytes[i];
+        entry->syscalls = processes->syscalls[i];
+    }
+}
+
+// Thread IDs share the PID space, so one table serves every watched process
+static void update_thread_cpu_usage(ThreadColumns *threads, gint64 timestamp) {
+    cpu_delta_begin(&thread_cpu);
+    for (guint i = 0; i < threads->len; i++) {
+        threads->cpu_usage[i] = cpu_delta_update(&thread_cpu, threads->tid[i], threads->starttime[i],
+                                                 threads->cpu_time[i], timestamp);
+    }
+}
+
+#define COLLECTOR_BIT(collector) (1u << (collector))
+
+// Run the collectors in due (COLLECTOR_BIT()s) one after the other, noting in
+// costs how long each took
+static Snapshot *collect_snapshot(guint due, const GArray *thread_pids, gint64 costs[N_SAMPLER_COLLECTORS]) {
+    Snapshot *snapshot = snapshot_new();
+    gint64 start = snapshot->timestamp;
+
+    for (guint collector = 0; collector < N_SAMPLER_COLLECTORS; collector++) {
+        if (!(due & COLLECTOR_BIT(collector))) {
+            continue;
+        }
+
+        switch (collector) {
+            case SAMPLER_CPU:
+                read_cpu_usage(&snapshot->system);
+                snapshot->contents |= SNAPSHOT_SYSTEM;
+                break;
+            case SAMPLER_MEMORY:
+                read_memory_usage(&snapshot->system);
+                snapshot->contents |= SNAPSHOT_SYSTEM;
+                break;
+            case SAMPLER_NETWORK:
+                read_network_usage(&snapshot->system);
+                snapshot->contents |= SNAPSHOT_SYSTEM;
+                break;
+            case SAMPLER_PROCESSES:
+                snapshot->processes = sampler_collect_processes(pool);
+                update_process_usage(snapshot->processes, start);
+                snapshot->contents |= SNAPSHOT_PROCESSES;
+                break;
+            case SAMPLER_THREADS:
+                snapshot->threads = sampler_collect_threads(thread_pids);
+                update_thread_cpu_usage(snapshot->threads, start);
+                snapshot->contents |= SNAPSHOT_THREADS;
+                break;
+            case SAMPLER_FILESYSTEMS:
+                snapshot->filesystems = read_filesystems();
+                snapshot->contents |= SNAPSHOT_FILESYSTEMS;
+                break;
+        }
+
+        gint64 end = g_get_monotonic_time();
+        costs[collector] = end - start;
+        start = end;
+    }
+    snapshot->process_scan_time = costs[SAMPLER_PROCESSES];
+
+    return snapshot;
+}
+
+// Main thread: remember the newest snapshot of each kind and notify listeners
+static gboolean dispatch_snapshot(gpointer data) {
+    g_mutex_lock(&lock);
+    Snapshot *snapshot = pending;
+    pending = NULL;
+    g_mutex_unlock(&lock);
+
+    if (snapshot == NULL) {
+        return G_SOURCE_REMOVE;
+    }
+
+    if (snapshot->contents & SNAPSHOT_SYSTEM) {
+        snapshot_unref(latest_system);
+        latest_system = snapshot_ref(snapshot);
+    }
+    if (snapshot->contents & SNAPSHOT_PROCESSES) {
+        snapshot_unref(latest_processes);
+        latest_processes = snapshot_ref(snapshot);
+    }
+    if (snapshot->contents & SNAPSHOT_FILESYSTEMS) {
+        snapshot_unref(latest_filesystems);
+        latest_filesystems = snapshot_ref(snapshot);
+    }
+
+    // Listeners may remove themselves while being called
+    GList *iter = listeners;
+    while (iter != NULL) {
+        ListenerEntry *entry = iter->data;
+        iter = iter->next;
+        entry->func(snapshot, entry->user_data);
+    }
+
+    snapshot_unref(snapshot);
+    return G_SOURCE_REMOVE;
+}
+
+// Sampler thread: queue a snapshot for the main loop. If the main loop has not
+// picked up the previous one yet, fold it into the new one rather than queueing
+// a second idle callback, so a stalled UI never builds a backlog.
+static void publish_snapshot(Snapshot *snapshot) {
+    g_mutex_lock(&lock);
+    Snapshot *previous = pending;
+    pending = snapshot;
+    if (previous != NULL) {
+        if ((previous->contents & SNAPSHOT_SYSTEM) && !(snapshot->contents & SNAPSHOT_SYSTEM)) {
+            snapshot->system = previous->system;
+            snapshot->contents |= SNAPSHOT_SYSTEM;
+        }
+        if ((previous->contents & SNAPSHOT_PROCESSES) && !(snapshot->contents & SNAPSHOT_PROCESSES)) {
+            snapshot->processes = previous->processes;
+            snapshot->process_scan_time = previous->process_scan_time;
+            snapshot->process_interval = previous->process_interval;
+            previous->processes = NULL;
+            snapshot->contents |= SNAPSHOT_PROCESSES;
+        }
+        if ((previous->contents & SNAPSHOT_THREADS) && !(snapshot->contents & SNAPSHOT_THREADS)) {
+            snapshot->threads = previous->threads;
+            previous->threads = NULL;
+            snapshot->contents |= SNAPSHOT_THREADS;
+        }
+        if ((previous->contents & SNAPSHOT_FILESYSTEMS) && !(snapshot->contents & SNAPSHOT_FILESYSTEMS)) {
+            snapshot->filesystems = previous->filesystems;
+            previous->filesystems = NULL;
+            snapshot->contents |= SNAPSHOT_FILESYSTEMS;
+        }
+    }
+    g_mutex_unlock(&lock);
+
+    if (previous != NULL) {
+        snapshot_unref(previous);
+    } else {
+        g_idle_add(dispatch_snapshot, NULL);
+    }
+}
+
+#define TICK_US ((gint64)SAMPLER_INTERVAL_MS * 1000)
+
+// First tick after now (monotonic clock). Ticks fall on wall-clock second
+// boundaries, so one tick's readings land in one 1 s history bucket, and
+// every collector due on a tick runs in the same pass and shares its
+// timestamps.
+static gint64 first_tick_after(gint64 now) {
+    return now + TICK_US - g_get_real_time() % TICK_US;
+}
+
+// Lock held: interval_ms is the shortest subscription to collector, or 0
+// with no subscribers. Intervals are rounded up to whole ticks. A collector
+// that starts or speeds up runs right away; one that slows down pushes its
+// next run back.
+static void set_collector_interval(SamplerCollector collector, guint interval_ms, guint subscribers) {
+    CollectorState *state = &collectors[collector];
+    guint interval = 0;
+
+    if (subscribers > 0) {
+        interval = (MAX(interval_ms, 1) + SAMPLER_INTERVAL_MS - 1) / SAMPLER_INTERVAL_MS * SAMPLER_INTERVAL_MS;
+    }
+    state->stats.subscribers = subscribers;
+    if (interval == state->interval) {
+        return;
+    }
+
+    if (state->interval == 0 || interval < state->interval) {
+        state->next_run = 0;
+    } else if (state->next_run != 0) {
+        state->next_run += (gint64)(interval - state->interval) * 1000;
+    }
+    state->interval = interval;
+    state->stats.interval = interval;
+    if (collector == SAMPLER_PROCESSES) {
+        process_effective = interval;
+    }
+    g_cond_signal(&wakeup);
+}
+
+// Lock held
+static void update_subscriptions(SamplerCollector collector) {
+    guint interval = 0, subscribers = 0;
+    for (GList *iter = subscriptions; iter != NULL; iter = iter->next) {
+        const Subscription *subscription = iter->data;
+        if (subscription->collector == collector) {
+            interval = subscribers == 0 ? subscription->interval : MIN(interval, subscription->interval);
+            subscribers++;
+        }
+    }
+    set_collector_interval(collector, interval, subscribers);
+}
+
+// Sampler thread, lock held: double the automatic interval while a scan takes
+// more than its budget, and halve it back towards the subscribed one once the
+// scan would fit the shorter interval again
+static void adapt_process_interval(gint64 scan_time) {
+    guint interval = collectors[SAMPLER_PROCESSES].interval;
+    if (interval == 0) {
+        return;
+    }
+
+    gint64 budget = (gint64)process_effective * 1000 * SAMPLER_PROCESS_BUDGET_PERCENT / 100;
+    if (scan_time > budget) {
+        // Never below what was asked for, which may exceed the usual cap
+        process_effective = MIN(process_effective * 2, MAX(SAMPLER_PROCESS_MAX_INTERVAL_MS, interval));
+    } else if (process_effective > interval && scan_time <= budget / 2) {
+        process_effective = MAX(process_effective / 2, interval);
+    }
+}
+
+// Sampler thread, lock held: account for a pass that started at base and
+// plan the next run of each collector in it
+static void finish_pass(guint due, const gint64 costs[N_SAMPLER_COLLECTORS], gint64 base) {
+    for (guint collector = 0; collector < N_SAMPLER_COLLECTORS; collector++) {
+        CollectorState *state = &collectors[collector];
+        if (!(due & COLLECTOR_BIT(collector))) {
+            continue;
+        }
+
+        state->stats.runs++;
+        state->stats.total_time += costs[collector];
+        state->stats.last_time = costs[collector];
+        state->stats.max_time = MAX(state->stats.max_time, costs[collector]);
+
+        guint interval = collector == SAMPLER_PROCESSES ? process_effective : state->interval;
+        state->next_run = base + (gint64)interval * 1000;
+    }
+}
+
+static gpointer sampler_thread(gpointer data) {
+    g_mutex_lock(&lock);
+    gint64 next_tick = first_tick_after(g_get_monotonic_time());
+
+    while (running) {
+        gint64 now = g_get_monotonic_time();
+        gboolean on_tick = now >= next_tick;
+        gint64 base = on_tick ? next_tick : now;
+        guint due = 0;
+
+        // Collectors run on the first tick at or after their next run; newly
+        // subscribed ones and requested scans run at once
+        for (guint collector = 0; collector < N_SAMPLER_COLLECTORS; collector++) {
+            const CollectorState *state = &collectors[collector];
+            if (state->interval != 0 && (state->next_run == 0 || (on_tick && state->next_run <= next_tick))) {
+                due |= COLLECTOR_BIT(collector);
+            }
+        }
+        if (processes_requested) {
+            due |= COLLECTOR_BIT(SAMPLER_PROCESSES);
+            processes_requested = FALSE;
+        }
+
+        if (on_tick) {
+            next_tick += TICK_US;
+            if (next_tick <= now) {
+                // Fell behind (suspend, heavy load): restart the cadence from now
+                next_tick = first_tick_after(now);
+            }
+        }
+        if (due == 0) {
+            g_cond_wait_until(&wakeup, &lock, next_tick);
+            continue;
+        }
+
+        GArray *thread_pids = NULL;
+        if (due & COLLECTOR_BIT(SAMPLER_THREADS)) {
+            GHashTableIter iter;
+            gpointer key;
+
+            thread_pids = g_array_new(FALSE, FALSE, sizeof(long));
+            g_hash_table_iter_init(&iter, thread_watches);
+            while (g_hash_table_iter_next(&iter, &key, NULL)) {
+                long pid = GPOINTER_TO_INT(key);
+                g_array_append_val(thread_pids, pid);
+            }
+        }
+
+        gint64 costs[N_SAMPLER_COLLECTORS] = { 0 };
+        g_mutex_unlock(&lock);
+        Snapshot *snapshot = collect_snapshot(due, thread_pids, costs);
+        if (thread_pids != NULL) {
+            g_array_unref(thread_pids);
+        }
+        g_mutex_lock(&lock);
+
+        if (due & COLLECTOR_BIT(SAMPLER_PROCESSES)) {
+            adapt_process_interval(costs[SAMPLER_PROCESSES]);
+            snapshot->process_interval = collectors[SAMPLER_PROCESSES].interval != 0 ? process_effective : 0;
+        }
+        finish_pass(due, costs, base);
+
+        // The wall clock was set or has drifted from the monotonic one
+        if (on_tick && snapshot->real_time % TICK_US > TICK_US / 4) {
+            next_tick = first_tick_after(g_get_monotonic_time());
+        }
+        g_mutex_unlock(&lock);
+
+        publish_snapshot(snapshot);
+        g_mutex_lock(&lock);
+    }
+    g_mutex_unlock(&lock);
+
+    return NULL;
+}
+
+void sampler_start(void) {
+    if (thread != NULL) {
+        return;
+    }
+    running = TRUE;
+    pool = scan_pool_new(0);
+    thread_watches = g_hash_table_new(g_direct_hash, g_direct_equal);
+    cpu_delta_init(&process_cpu);
+    cpu_delta_init(&thread_cpu);
+    proc_events_start();    // optional; scans list /proc when it fails
+    thread = g_thread_new("sampler", sampler_thread, NULL);
+}
+
+void sampler_stop(void) {
+    if (thread == NULL) {
+        return;
+    }
+
+    g_mutex_lock(&lock);
+    running = FALSE;
+    g_cond_signal(&wakeup);
+    g_mutex_unlock(&lock);
+
+    g_thread_join(thread);
+    thread = NULL;
+    proc_events_stop();
+
+    scan_pool_free(pool);
+    pool = NULL;
+    cpu_delta_clear(&process_cpu);
+    cpu_delta_clear(&thread_cpu);
+    g_clear_pointer(&thread_watches, g_hash_table_destroy);
+    procfs_file_close(&stat_file);
+    procfs_file_close(&meminfo_file);
+    procfs_file_close(&net_dev_file);
+    procfs_file_close(&mounts_file);
+
+    g_mutex_lock(&lock);
+    snapshot_unref(pending);
+    pending = NULL;
+    g_list_free_full(subscriptions, g_free);
+    subscriptions = NULL;
+    memset(collectors, 0, sizeof(collectors));
+    g_mutex_unlock(&lock);
+
+    g_clear_pointer(&latest_system, snapshot_unref);
+    g_clear_pointer(&latest_processes, snapshot_unref);
+    g_clear_pointer(&latest_filesystems, snapshot_unref);
+}
+
+// Have collector run at least every interval_ms until sampler_unsubscribe()
+// with the returned id. Views subscribe while they are on screen. Threads
+// are subscribed to through sampler_watch_threads() instead.
+guint sampler_subscribe(SamplerCollector collector, guint interval_ms) {
+    g_return_val_if_fail(collector < N_SAMPLER_COLLECTORS && collector != SAMPLER_THREADS, 0);
+
+    Subscription *subscription = g_new0(Subscription, 1);
+    subscription->collector = collector;
+    subscription->interval = interval_ms;
+
+    g_mutex_lock(&lock);
+    subscription->id = next_subscription_id++;
+    subscriptions = g_list_append(subscriptions, subscription);
+    update_subscriptions(collector);
+    g_mutex_unlock(&lock);
+    return subscription->id;
+}
+
+void sampler_unsubscribe(guint id) {
+    g_mutex_lock(&lock);
+    for (GList *iter = subscriptions; iter != NULL; iter = iter->next) {
+        Subscription *subscription = iter->data;
+        if (subscription->id == id) {
+            subscriptions = g_list_delete_link(subscriptions, iter);
+            update_subscriptions(subscription->collector);
+            g_free(subscription);
+            break;
+        }
+    }
+    g_mutex_unlock(&lock);
+}
+
+// Ask the sampler thread for a process scan as soon as possible
+void sampler_request_processes(void) {
+    g_mutex_lock(&lock);
+    processes_requested = TRUE;
+    g_cond_signal(&wakeup);
+    g_mutex_unlock(&lock);
+}
+
+// Include the threads of pid in every tick until a matching unwatch.
+// Watches are counted, so two views of one process can come and go freely.
+void sampler_watch_threads(pid_t pid) {
+    g_mutex_lock(&lock);
+    if (thread_watches != NULL) {
+        gpointer key = GINT_TO_POINTER(pid);
+        guint count = GPOINTER_TO_UINT(g_hash_table_lookup(thread_watches, key));
+        g_hash_table_insert(thread_watches, key, GUINT_TO_POINTER(count + 1));
+        set_collector_interval(SAMPLER_THREADS, SAMPLER_INTERVAL_MS, g_hash_table_size(thread_watches));
+    }
+    g_mutex_unlock(&lock);
+}
+
+void sampler_unwatch_threads(pid_t pid) {
+    g_mutex_lock(&lock);
+    if (thread_watches != NULL) {
+        gpointer key = GINT_TO_POINTER(pid);
+        guint count = GPOINTER_TO_UINT(g_hash_table_lookup(thread_watches, key));
+        if (count > 1) {
+            g_hash_table_insert(thread_watches, key, GUINT_TO_POINTER(count - 1));
+        } else {
+            g_hash_table_remove(thread_watches, key);
+        }
+        guint watched = g_hash_table_size(thread_watches);
+        set_collector_interval(SAMPLER_THREADS, watched > 0 ? SAMPLER_INTERVAL_MS : 0, watched);
+    }
+    g_mutex_unlock(&lock);
+}
+
+guint sampler_add_listener(SnapshotListener listener, gpointer user_data) {
+    ListenerEntry *entry = g_new0(ListenerEntry, 1);
+    entry->id = next_listener_id++;
+    entry->func = listener;
+    entry->user_data = user_data;
+    listeners = g_list_append(listeners, entry);
+    return entry->id;
+}
+
+void sampler_remove_listener(guint id) {
+    for (GList *iter = listeners; iter != NULL; iter = iter->next) {
+        ListenerEntry *entry = iter->data;
+        if (entry->id == id) {
+            listeners = g_list_delete_link(listeners, iter);
+            g_free(entry);
+            return;
+        }
+    }
+}
+
+// Newest snapshot that carried all of the requested parts, or NULL
+const Snapshot *sampler_get_latest(guint contents) {
+    if (contents & SNAPSHOT_PROCESSES) {
+        return latest_processes;
+    }
+    if (contents & SNAPSHOT_FILESYSTEMS) {
+        return latest_filesystems;
+    }
+    return latest_system;
+}
+
+// Copy of every collector's schedule and cost so far
+void sampler_get_collector_stats(CollectorStats stats[N_SAMPLER_COLLECTORS]) {
+    g_mutex_lock(&lock);
+    for (guint collector = 0; collector < N_SAMPLER_COLLECTORS; collector++) {
+        stats[collector] = collectors[collector].stats;
+    }
+    g_mutex_unlock(&lock);
+}
+
+const gchar *sampler_collector_name(SamplerCollector collector) {
+    return collector < N_SAMPLER_COLLECTORS ? collector_names[collector] : NULL;
+}
@@ -0,0 +1,183 @@
+// sampler.h
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <gtk/gtk.h>
+
+#include "procfs.h"
+#include "scan_pool.h"
+
+#define SAMPLER_INTERVAL_MS 1000    // one tick; every collector runs on ticks
+#define SAMPLER_MAX_INTERFACES 32
+#define SAMPLER_MAX_CPUS 512
+
+// Automatic process scans: the interval is stretched (up to the maximum, or the
+// interval asked for if that is longer) while a scan costs more than
+// SAMPLER_PROCESS_BUDGET_PERCENT of it
+#define SAMPLER_PROCESS_INTERVAL_MS 2000
+#define SAMPLER_PROCESS_MAX_INTERVAL_MS 30000
+#define SAMPLER_PROCESS_BUDGET_PERCENT 10
+
+// Bits describing which parts of a snapshot were collected
+#define SNAPSHOT_SYSTEM      (1 << 0)    // any of CPU, memory and network
+#define SNAPSHOT_PROCESSES   (1 << 1)
+#define SNAPSHOT_THREADS     (1 << 2)
+#define SNAPSHOT_FILESYSTEMS (1 << 3)
+
+// What the sampler thread can read. Each runs only while subscribed to,
+// at the shortest interval asked for, see sampler_subscribe().
+typedef enum {
+    SAMPLER_CPU,            // aggregate and per-core usage, /proc/stat
+    SAMPLER_MEMORY,         // /proc/meminfo
+    SAMPLER_NETWORK,        // /proc/net/dev
+    SAMPLER_PROCESSES,      // every process, see ProcessColumns
+    SAMPLER_THREADS,        // threads of watched processes, see sampler_watch_threads()
+    SAMPLER_FILESYSTEMS,    // mounted file systems
+    N_SAMPLER_COLLECTORS
+} SamplerCollector;
+
+// Cost of one collector since the sampler started
+typedef struct {
+    guint interval;         // ms between runs, 0 while nobody subscribes
+    guint subscribers;
+    guint64 runs;
+    gint64 total_time;      // microseconds over all runs
+    gint64 last_time;
+    gint64 max_time;
+} CollectorStats;
+
+// Result of one process scan, stored as a struct of arrays in a single
+// allocation: row i of every column describes the same PID. Views read the
+// columns in place instead of copying rows out.
+typedef struct {
+    guint len;
+    long *pid;
+    long *ppid;                 // parent PID, 0 for init and kthreadd
+    guint64 *starttime;         // clock ticks after boot, tells a reused PID apart
+    guint64 *cpu_time;          // utime + stime, clock ticks
+    const gchar **user;         // interned, see user_cache_lookup()
+    gfloat *memory;             // MiB
+    gfloat *cpu_usage;          // percent of one CPU since the previous scan
+    guint64 *read_bytes;        // io: cumulative block layer bytes, 0 when unreadable
+    guint64 *write_bytes;
+    guint64 *syscalls;          // io: read plus write syscalls
+    gfloat *read_rate;          // bytes/s since the previous scan, -1 when io is unreadable
+    gfloat *write_rate;
+    gfloat *syscall_rate;       // calls/s, -1 when io is unreadable
+    char (*name)[PROCFS_COMM_LEN];
+    char *state;                // one-letter state, see procfs_state_name()
+
+    // Name index for searching: each distinct name once, so name terms are
+    // evaluated per name rather than per row. Built by process_columns_index_names().
+    guint serial;               // unique per index, for caching per-name results
+    guint32 *name_id;           // row -> distinct name
+    guint n_names;
+    guint32 *name_row;          // distinct name -> first row carrying it
+    char (*name_lower)[PROCFS_COMM_LEN];    // distinct name, ASCII-lowercased
+    guint32 *name_rank;         // distinct name -> position in case-insensitive order
+} ProcessColumns;
+
+// Threads of the processes watched with sampler_watch_threads(), taken on
+// every tick while any are watched. Same layout rules as ProcessColumns.
+typedef struct {
+    guint len;
+    long *pid;                  // thread group (process) of the thread
+    long *tid;
+    guint64 *starttime;         // clock ticks after boot
+    guint64 *cpu_time;          // utime + stime, clock ticks
+    guint64 *voluntary_switches;
+    guint64 *involuntary_switches;
+    gfloat *cpu_usage;          // percent of one CPU since the previous tick
+    gint *processor;            // CPU the thread last ran on
+    char (*name)[PROCFS_COMM_LEN];
+    char *state;
+} ThreadColumns;
+
+// Cumulative byte counters of one network interface, and the rates they
+// imply since the previous tick (0 on an interface's first tick)
+typedef struct {
+    gchar name[32];
+    guint64 received;
+    guint64 transmitted;
+    gdouble received_rate;      // bytes/s
+    gdouble transmitted_rate;
+} InterfaceSample;
+
+// Share of each core's time since the previous tick, in percent, split by
+// kind. Indexed by CPU number; offline CPUs read 0.
+typedef struct {
+    guint n_cpus;                       // highest CPU number seen plus one
+    gfloat user[SAMPLER_MAX_CPUS];      // user + nice
+    gfloat system[SAMPLER_MAX_CPUS];    // system + irq + softirq
+    gfloat iowait[SAMPLER_MAX_CPUS];
+    gfloat steal[SAMPLER_MAX_CPUS];
+} CoreSample;
+
+// One mounted file system, sizes in bytes
+typedef struct {
+    gchar device[128];
+    gchar mount_point[256];
+    gchar type[32];
+    guint64 total;
+    guint64 free;
+    guint64 available;      // free to unprivileged users
+} FileSystemSample;
+
+// System-wide readings taken on one tick. Parts whose collector has no
+// subscriber read 0.
+typedef struct {
+    float cpu_usage;    // aggregate CPU percentage
+    CoreSample cores;
+    unsigned long mem_total;   // kB, as reported by /proc/meminfo
+    unsigned long mem_free;
+    unsigned long swap_total;
+    unsigned long swap_free;
+    gint64 network_time;        // g_get_monotonic_time() when the counters were read
+    gdouble received_rate;      // all interfaces, bytes/s
+    gdouble transmitted_rate;
+    guint n_interfaces;
+    InterfaceSample interfaces[SAMPLER_MAX_INTERFACES];
+} SystemSample;
+
+// Immutable result of one sampler pass. Listeners must not modify it; take a
+// reference with snapshot_ref() to keep it past the callback.
+typedef struct {
+    gint ref_count;
+    guint contents;             // SNAPSHOT_* bits
+    gint64 timestamp;           // g_get_monotonic_time() when the pass started
+    gint64 real_time;           // g_get_real_time() then; ticks fall on whole seconds
+    gint64 process_scan_time;   // microseconds spent walking /proc
+    guint process_interval;     // ms until the next automatic scan, 0 if paused
+    SystemSample system;
+    ProcessColumns *processes;  // NULL unless SNAPSHOT_PROCESSES
+    ThreadColumns *threads;     // NULL unless SNAPSHOT_THREADS
+    GArray *filesystems;        // FileSystemSample, NULL unless SNAPSHOT_FILESYSTEMS
+} Snapshot;
+
+typedef void (*SnapshotListener)(const Snapshot *snapshot, gpointer user_data);
+
+void sampler_start(void);
+void sampler_stop(void);
+guint sampler_subscribe(SamplerCollector collector, guint interval_ms);
+void sampler_unsubscribe(guint id);
+void sampler_request_processes(void);
+void sampler_watch_threads(pid_t pid);
+void sampler_unwatch_threads(pid_t pid);
+guint sampler_add_listener(SnapshotListener listener, gpointer user_data);
+void sampler_remove_listener(guint id);
+const Snapshot *sampler_get_latest(guint contents);
+void sampler_get_collector_stats(CollectorStats stats[N_SAMPLER_COLLECTORS]);
+const gchar *sampler_collector_name(SamplerCollector collector);
+void sampler_collect_system(SystemSample *sample);
+ProcessColumns *sampler_collect_processes(ScanPool *pool);
+ProcessColumns *process_columns_new(guint capacity);
+void process_columns_copy_row(ProcessColumns *dst, guint dst_row, const ProcessColumns *src, guint src_row);
+void process_columns_index_names(ProcessColumns *columns);
+void process_columns_free(ProcessColumns *columns);
+ThreadColumns *sampler_collect_threads(const GArray *pids);
+void thread_columns_free(ThreadColumns *columns);
+
+Snapshot *snapshot_ref(const Snapshot *snapshot);
+void snapshot_unref(const Snapshot *snapshot);
+
+#endif
@@ -0,0 +1,228 @@
+/*
+ * scan_pool.c
+ * Small work-stealing thread pool used to parse /proc in parallel.
+ *
+ * Every worker owns a deque of task indices. A job is split into contiguous
+ * ranges, one per worker; a worker pops from the back of its own deque and,
+ * once that is empty, steals from the front of the others. Slow PIDs (large
+ * status files, contended mm locks) therefore never leave the rest of the
+ * pool idle. The calling thread takes part as worker 0, so a pool of one
+ * thread runs everything inline.
+ */
+
+#include <glib.h>
+
+#include "scan_pool.h"
+
+typedef struct {
+    GMutex lock;
+    guint *tasks;
+    guint head;         // next task for thieves
+    guint tail;         // one past the next task for the owner
+} WorkDeque;
+
+struct _ScanPool {
+    guint n_workers;            // including the calling thread
+    GThread **threads;          // n_workers - 1 helpers
+    WorkDeque *deques;          // one per worker
+    guint capacity;             // size of each deque's task array
+
+    GMutex lock;
+    GCond work_cond;
+    GCond done_cond;
+    guint job_id;
+    guint active;               // workers still busy with the current job
+    gboolean shutting_down;
+    ScanTaskFunc func;
+    gpointer user_data;
+};
+
+typedef struct {
+    ScanPool *pool;
+    guint index;
+} WorkerArgs;
+
+static gboolean deque_pop(WorkDeque *deque, guint *task) {
+    gboolean found = FALSE;
+    g_mutex_lock(&deque->lock);
+    if (deque->head < deque->tail) {
+        *task = deque->tasks[--deque->tail];
+        found = TRUE;
+    }
+    g_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static gboolean deque_steal(WorkDeque *deque, guint *task) {
+    gboolean found = FALSE;
+    g_mutex_lock(&deque->lock);
+    if (deque->head < deque->tail) {
+        *task = deque->tasks[deque->head++];
+        found = TRUE;
+    }
+    g_mutex_unlock(&deque->lock);
+    return found;
+}
+
+// Drain our own deque, then steal until every deque is empty. No tasks are
+// added once a job has started, so one empty sweep means the job is done.
+static void run_worker(ScanPool *pool, guint index) {
+    guint task;
+
+    for (;;) {
+        if (deque_pop(&pool->deques[index], &task)) {
+            pool->func(task, pool->user_data);
+            continue;
+        }
+
+        gboolean stole = FALSE;
+        for (guint i = 1; i < pool->n_workers && !stole; i++) {
+            WorkDeque *victim = &pool->deques[(index + i) % pool->n_workers];
+            if (deque_steal(victim, &task)) {
+                pool->func(task, pool->user_data);
+                stole = TRUE;
+            }
+        }
+        if (!stole) {
+            break;
+        }
+    }
+
+    g_mutex_lock(&pool->lock);
+    if (--pool->active == 0) {
+        g_cond_signal(&pool->done_cond);
+    }
+    g_mutex_unlock(&pool->lock);
+}
+
+static gpointer worker_thread(gpointer data) {
+    WorkerArgs *args = data;
+    ScanPool *pool = args->pool;
+    guint index = args->index;
+    guint seen_job = 0;
+
+    g_free(args);
+
+    g_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->shutting_down && pool->job_id == seen_job) {
+            g_cond_wait(&pool->work_cond, &pool->lock);
+        }
+        if (pool->shutting_down) {
+            break;
+        }
+        seen_job = pool->job_id;
+        g_mutex_unlock(&pool->lock);
+
+        run_worker(pool, index);
+
+        g_mutex_lock(&pool->lock);
+    }
+    g_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+// n_threads == 0 sizes the pool to the number of online processors
+ScanPool *scan_pool_new(guint n_threads) {
+    ScanPool *pool = g_new0(ScanPool, 1);
+
+    if (n_threads == 0) {
+        n_threads = g_get_num_processors();
+    }
+    pool->n_workers = MAX(n_threads, 1);
+    pool->deques = g_new0(WorkDeque, pool->n_workers);
+    pool->threads = g_new0(GThread *, pool->n_workers);
+
+    g_mutex_init(&pool->lock);
+    g_cond_init(&pool->work_cond);
+    g_cond_init(&pool->done_cond);
+
+    for (guint i = 0; i < pool->n_workers; i++) {
+        g_mutex_init(&pool->deques[i].lock);
+    }
+    for (guint i = 1; i < pool->n_workers; i++) {
+        WorkerArgs *args = g_new0(WorkerArgs, 1);
+        args->pool = pool;
+        args->index = i;
+        pool->threads[i] = g_thread_new("scan-worker", worker_thread, args);
+    }
+
+    return pool;
+}
+
+void scan_pool_free(ScanPool *pool) {
+    if (pool == NULL) {
+        return;
+    }
+
+    g_mutex_lock(&pool->lock);
+    pool->shutting_down = TRUE;
+    g_cond_broadcast(&pool->work_cond);
+    g_mutex_unlock(&pool->lock);
+
+    for (guint i = 1; i < pool->n_workers; i++) {
+        g_thread_join(pool->threads[i]);
+    }
+    for (guint i = 0; i < pool->n_workers; i++) {
+        g_mutex_clear(&pool->deques[i].lock);
+        g_free(pool->deques[i].tasks);
+    }
+
+    g_mutex_clear(&pool->lock);
+    g_cond_clear(&pool->work_cond);
+    g_cond_clear(&pool->done_cond);
+    g_free(pool->deques);
+    g_free(pool->threads);
+    g_free(pool);
+}
+
+guint scan_pool_get_n_threads(const ScanPool *pool) {
+    return pool->n_workers;
+}
+
+// Run func for every index in [0, n_tasks) and return once all have finished.
+// Not reentrant: only one thread may drive a given pool at a time.
+void scan_pool_run(ScanPool *pool, guint n_tasks, ScanTaskFunc func, gpointer user_data) {
+    if (n_tasks == 0) {
+        return;
+    }
+
+    if (n_tasks > pool->capacity) {
+        for (guint i = 0; i < pool->n_workers; i++) {
+            pool->deques[i].tasks = g_renew(guint, pool->deques[i].tasks, n_tasks);
+        }
+        pool->capacity = n_tasks;
+    }
+
+    // Hand each worker a contiguous range; stealing evens out the rest
+    for (guint i = 0; i < pool->n_workers; i++) {
+        WorkDeque *deque = &pool->deques[i];
+        guint first = (guint)((guint64)n_tasks * i / pool->n_workers);
+        guint last = (guint)((guint64)n_tasks * (i + 1) / pool->n_workers);
+
+        g_mutex_lock(&deque->lock);
+        deque->head = 0;
+        deque->tail = 0;
+        for (guint task = first; task < last; task++) {
+            deque->tasks[deque->tail++] = task;
+        }
+        g_mutex_unlock(&deque->lock);
+    }
+
+    g_mutex_lock(&pool->lock);
+    pool->func = func;
+    pool->user_data = user_data;
+    pool->active = pool->n_workers;
+    pool->job_id++;
+    g_cond_broadcast(&pool->work_cond);
+    g_mutex_unlock(&pool->lock);
+
+    run_worker(pool, 0);
+
+    g_mutex_lock(&pool->lock);
+    while (pool->active > 0) {
+        g_cond_wait(&pool->done_cond, &pool->lock);
+    }
+    g_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,17 @@
+// scan_pool.h
+#ifndef SCAN_POOL_H
+#define SCAN_POOL_H
+
+#include <glib.h>
+
+typedef struct _ScanPool ScanPool;
+
+// Runs one task; called concurrently from several threads with distinct indices
+typedef void (*ScanTaskFunc)(guint task, gpointer user_data);
+
+ScanPool *scan_pool_new(guint n_threads);
+void scan_pool_free(ScanPool *pool);
+guint scan_pool_get_n_threads(const ScanPool *pool);
+void scan_pool_run(ScanPool *pool, guint n_tasks, ScanTaskFunc func, gpointer user_data);
+
+#endif
@@ -5,6 +5,8 @@
 #include <string.h>
 #include <sys/statvfs.h>
 
+#include "sampler.h"
+
 /*
  * Function to get all system information
  */
@@ -121,6 +123,25 @@ void display_system_info(GtkWidget *info_box) {
     printf("Couldn't get disk space information\n");
   }
 
+  // What each of the sampler's collectors has cost so far
+  CollectorStats stats[N_SAMPLER_COLLECTORS];
+  sampler_get_collector_stats(stats);
+  snprintf(info_buffer + strlen(info_buffer), sizeof(info_buffer) - strlen(info_buffer), "\n\nSampler:\n");
+  snprintf(info_buffer + strlen(info_buffer), sizeof(info_buffer) - strlen(info_buffer), "--------------------------------\n");
+  for (int i = 0; i < N_SAMPLER_COLLECTORS; i++) {
+    char schedule[32];
+    if (stats[i].interval != 0) {
+      snprintf(schedule, sizeof(schedule), "every %u s", stats[i].interval / 1000);
+    } else {
+      snprintf(schedule, sizeof(schedule), "idle");
+    }
+    double average = stats[i].runs != 0 ? stats[i].total_time / 1000.0 / stats[i].runs : 0.0;
+    snprintf(info_buffer + strlen(info_buffer), sizeof(info_buffer) - strlen(info_buffer),
+             "%s: %s, %" G_GUINT64_FORMAT " runs, avg %.2f ms, last %.2f ms, max %.2f ms\n",
+             sampler_collector_name(i), schedule, stats[i].runs, average,
+             stats[i].last_time / 1000.0, stats[i].max_time / 1000.0);
+  }
+
   // Create a GtkLabel for the system info
   GtkWidget *info_label = gtk_label_new(info_buffer);
   gtk_label_set_selectable(GTK_LABEL(info_label), TRUE);
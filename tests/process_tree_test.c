@@ -0,0 +1,84 @@
+/*
+ * process_tree_test.c
+ * Rows kept by the tree-mode filter: every match and all of its ancestors,
+ * so a matching process stays reachable under parents that do not match.
+ * Run with `make check`.
+ */
+
+#include <glib.h>
+
+#include "process_query.h"
+
+// init(1, root) -> sshd(400, root) -> sshd(410, alice) -> bash(411, alice)
+//               -> cron(500, root)
+// kthreadd(2, root) -> kworker(3, root)
+#define N_ROWS 7
+
+static long pids[N_ROWS] = { 1, 400, 410, 411, 500, 2, 3 };
+static long ppids[N_ROWS] = { 0, 1, 400, 410, 1, 0, 2 };
+static const gchar *users[N_ROWS] = { "root", "root", "alice", "alice", "root", "root", "root" };
+
+static ProcessColumns make_columns(void) {
+    ProcessColumns columns = { 0 };
+    columns.len = N_ROWS;
+    columns.pid = pids;
+    columns.ppid = ppids;
+    columns.user = users;
+    return columns;
+}
+
+static gboolean owned_by(const ProcessColumns *columns, guint row, gpointer user_data) {
+    return g_strcmp0(columns->user[row], user_data) == 0;
+}
+
+static gboolean is_pid(const ProcessColumns *columns, guint row, gpointer user_data) {
+    return columns->pid[row] == GPOINTER_TO_INT(user_data);
+}
+
+// "Only my processes": alice's shell under root-owned sshd and init stays
+// reachable, while root-only subtrees are dropped
+static void test_owner_under_root_parents(void) {
+    ProcessColumns columns = make_columns();
+    guint8 marks[N_ROWS];
+    static const guint8 expected[N_ROWS] = { 1, 1, 1, 1, 0, 0, 0 };
+
+    process_query_mark_tree(&columns, owned_by, "alice", marks);
+    for (guint row = 0; row < N_ROWS; row++) {
+        g_assert_cmpuint(marks[row], ==, expected[row]);
+    }
+}
+
+// A single matching leaf keeps its whole chain of ancestors and nothing else
+static void test_leaf_match(void) {
+    ProcessColumns columns = make_columns();
+    guint8 marks[N_ROWS];
+    static const guint8 expected[N_ROWS] = { 0, 0, 0, 0, 0, 1, 1 };
+
+    process_query_mark_tree(&columns, is_pid, GINT_TO_POINTER(3), marks);
+    for (guint row = 0; row < N_ROWS; row++) {
+        g_assert_cmpuint(marks[row], ==, expected[row]);
+    }
+}
+
+// A PPID loop (a PID reused while its old children were being read) ends
+static void test_parent_loop(void) {
+    long loop_pids[2] = { 10, 11 };
+    long loop_ppids[2] = { 11, 10 };
+    ProcessColumns columns = { 0 };
+    guint8 marks[2];
+
+    columns.len = 2;
+    columns.pid = loop_pids;
+    columns.ppid = loop_ppids;
+    process_query_mark_tree(&columns, is_pid, GINT_TO_POINTER(10), marks);
+    g_assert_cmpuint(marks[0], ==, 1);
+    g_assert_cmpuint(marks[1], ==, 1);
+}
+
+int main(int argc, char *argv[]) {
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func("/process-tree/owner-under-root-parents", test_owner_under_root_parents);
+    g_test_add_func("/process-tree/leaf-match", test_leaf_match);
+    g_test_add_func("/process-tree/parent-loop", test_parent_loop);
+    return g_test_run();
+}
@@ -0,0 +1,77 @@
+/*
+ * user_cache.c
+ * UID -> user name cache. getpwuid_r() can mean file or socket traffic with
+ * LDAP/NSS-backed accounts, so each UID is resolved once and the result kept
+ * until /etc/passwd changes. Names are interned with g_intern_string(), so
+ * callers may keep and compare the returned pointers without copying them.
+ */
+
+#include <glib.h>
+#include <pwd.h>
+#include <sys/stat.h>
+
+#include "user_cache.h"
+
+#define PASSWD_PATH "/etc/passwd"
+
+G_LOCK_DEFINE_STATIC(user_cache);
+static GHashTable *names = NULL;    // GUINT_TO_POINTER(uid) -> interned name
+static struct stat passwd_stat;     // /etc/passwd as of the last revalidation
+
+static const gchar *resolve_username(uid_t uid) {
+    struct passwd pwd;
+    struct passwd *pw = NULL;
+    char buf[1024];
+
+    if (getpwuid_r(uid, &pwd, buf, sizeof(buf), &pw) == 0 && pw != NULL) {
+        return g_intern_string(pw->pw_name);
+    }
+    return g_intern_static_string("Unknown");
+}
+
+// Interned name for uid; safe to call from any thread
+const gchar *user_cache_lookup(uid_t uid) {
+    const gchar *name;
+
+    G_LOCK(user_cache);
+    if (names == NULL) {
+        names = g_hash_table_new(g_direct_hash, g_direct_equal);
+    }
+    name = g_hash_table_lookup(names, GUINT_TO_POINTER(uid));
+    G_UNLOCK(user_cache);
+
+    if (name != NULL) {
+        return name;
+    }
+
+    // Resolve outside the lock so a slow NSS backend does not stall other lookups
+    name = resolve_username(uid);
+
+    G_LOCK(user_cache);
+    g_hash_table_insert(names, GUINT_TO_POINTER(uid), (gpointer)name);
+    G_UNLOCK(user_cache);
+
+    return name;
+}
+
+// Drop every cached name if /etc/passwd was modified since the last call.
+// Cheap enough (one stat) to run before every process scan.
+void user_cache_revalidate(void) {
+    struct stat st;
+
+    if (stat(PASSWD_PATH, &st) != 0) {
+        return;
+    }
+
+    G_LOCK(user_cache);
+    if (st.st_mtim.tv_sec != passwd_stat.st_mtim.tv_sec ||
+        st.st_mtim.tv_nsec != passwd_stat.st_mtim.tv_nsec ||
+        st.st_ino != passwd_stat.st_ino ||
+        st.st_size != passwd_stat.st_size) {
+        if (names != NULL) {
+            g_hash_table_remove_all(names);
+        }
+        passwd_stat = st;
+    }
+    G_UNLOCK(user_cache);
+}
@@ -0,0 +1,11 @@
+// user_cache.h
+#ifndef USER_CACHE_H
+#define USER_CACHE_H
+
+#include <glib.h>
+#include <sys/types.h>
+
+const gchar *user_cache_lookup(uid_t uid);
+void user_cache_revalidate(void);
+
+#endif